@@ -0,0 +1,128 @@
+#include "../mylog/mylog.h"
+#include <coroutine>
+
+/*
+    协程接口的检查，需要C++20(make coro)：
+        异步日志器的缓冲区很小、落地很慢，协程连续co_await logAsync时会因缓冲区满而挂起，
+        在异步线程腾出空间后恢复；全部写完后co_await flushAsync，恢复时所有日志已经落地且保持写入顺序
+    任何一项失败时返回非0
+*/
+#ifndef MYLOG_COROUTINE
+#error "需要支持协程的编译器和-std=c++20"
+#endif
+
+class MemorySink : public mylog::LogSink
+{
+public:
+    void log(const char *data, const size_t &len)
+    {
+        usleep(200);
+        std::unique_lock<std::mutex> lock(_mutex);
+        _data.append(data, len);
+    }
+    std::string data()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        return _data;
+    }
+
+private:
+    std::mutex _mutex;
+    std::string _data;
+};
+
+static size_t g_failed = 0;
+
+static void expect(bool ok, const std::string &what)
+{
+    std::cout << (ok ? "通过: " : "失败: ") << what << std::endl;
+    g_failed += !ok;
+}
+
+// 立即开始执行、结束后自动销毁的协程
+struct Task
+{
+    struct promise_type
+    {
+        Task get_return_object() { return {}; }
+        std::suspend_never initial_suspend() { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+static const int RECORDS = 500;
+
+struct State
+{
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool done = false;
+    int failed_status = 0; // 返回值不是OK的logAsync次数
+    std::atomic<int> resumed{0};
+    std::string at_flush; // flushAsync恢复时落地方向中的内容
+};
+
+static Task writer(mylog::Logger::ptr logger, std::shared_ptr<MemorySink> sink, State &state)
+{
+    // 记录恢复的次数，确认协程确实因缓冲区满挂起过
+    mylog::Logger::Resumer resumer = [&state](std::coroutine_handle<> handle)
+    {
+        ++state.resumed;
+        handle.resume();
+    };
+    std::string padding(200, 'x');
+    for (int i = 0; i < RECORDS; ++i)
+    {
+        mylog::LogStatus status = co_await logger->logAsync(resumer, mylog::LogLevel::value::INFO, __FILE__, __LINE__, "seq=%d %s", i, padding.c_str());
+        state.failed_status += status != mylog::LogStatus::OK;
+    }
+    co_await logger->flushAsync();
+    std::unique_lock<std::mutex> lock(state.mutex);
+    state.at_flush = sink->data();
+    state.done = true;
+    state.cond.notify_all();
+}
+
+int main()
+{
+    auto sink = std::make_shared<MemorySink>();
+    std::unique_ptr<mylog::LoggerBuilder> builder(new mylog::LocalLoggerBuilder());
+    builder->buildLoggername("check.coro");
+    builder->buildLoggerType(mylog::LoggerType::LOGGER_ASYNC);
+    builder->buildBufferSize(4096);
+    builder->buildFormatter("%m%n");
+    builder->buildSink(sink);
+    mylog::Logger::ptr logger = builder->build();
+
+    State state;
+    writer(logger, sink, state);
+    bool finished;
+    {
+        std::unique_lock<std::mutex> lock(state.mutex);
+        finished = state.cond.wait_for(lock, std::chrono::seconds(10), [&]()
+                                       { return state.done; });
+    }
+    expect(finished, "flushAsync恢复协程");
+    if (!finished)
+        return 1;
+    expect(state.failed_status == 0, "logAsync全部成功");
+    expect(state.resumed > 0, "缓冲区满时协程挂起并由异步线程恢复");
+
+    // flushAsync恢复时全部日志已经落地，并且按写入顺序排列
+    bool ordered = true;
+    size_t pos = 0;
+    for (int i = 0; i < RECORDS && ordered; ++i)
+    {
+        std::string head = "seq=" + std::to_string(i) + " ";
+        ordered = state.at_flush.compare(pos, head.size(), head) == 0;
+        pos = state.at_flush.find('\n', pos);
+        ordered = ordered && pos != std::string::npos;
+        ++pos;
+    }
+    expect(ordered && pos == state.at_flush.size(), "flushAsync恢复时日志全部落地且保持顺序");
+
+    std::cout << (g_failed ? "存在失败的检查\n" : "全部通过\n");
+    return g_failed ? 1 : 0;
+}
@@ -0,0 +1,135 @@
+#include "../mylog/mylog.h"
+#include "../mylog/dgram.hpp"
+#include <vector>
+#include <chrono>
+#include <poll.h>
+
+// 本地假接收端：校验每个线程的日志是否按序到达，并统计高负载下的丢失数量
+class FakeReceiver
+{
+public:
+    FakeReceiver(const std::string &path, size_t thr_count)
+        : _path(path), _last_seq(thr_count, -1), _received(0), _disorder(0), _stop(false)
+    {
+        unlink(path.c_str());
+        _fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        int ret = bind(_fd, (struct sockaddr *)&addr, sizeof(addr));
+        assert(ret == 0);
+        int rcvbuf = 4 * 1024 * 1024;
+        setsockopt(_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+        _thread = std::thread(&FakeReceiver::threadEntry, this);
+    }
+    ~FakeReceiver()
+    {
+        _stop = true;
+        _thread.join();
+        close(_fd);
+        unlink(_path.c_str());
+    }
+    size_t received() { return _received; }
+    size_t disorder() { return _disorder; }
+
+private:
+    void threadEntry()
+    {
+        char buf[DGRAM_MAX_SIZE];
+        struct pollfd pfd = {_fd, POLLIN, 0};
+        while (!_stop)
+        {
+            if (poll(&pfd, 1, 100) <= 0)
+                continue;
+            ssize_t n = recv(_fd, buf, sizeof(buf) - 1, 0);
+            if (n <= 0)
+                continue;
+            buf[n] = '\0';
+            int thr = 0;
+            long seq = 0;
+            if (sscanf(buf, "%d %ld", &thr, &seq) != 2 || thr < 0 || thr >= (int)_last_seq.size())
+                continue;
+            // 同一线程的序号必须递增，丢包会产生跳跃但不应乱序
+            if (seq <= _last_seq[thr])
+                ++_disorder;
+            _last_seq[thr] = seq;
+            ++_received;
+        }
+    }
+
+private:
+    std::string _path;
+    int _fd;
+    std::vector<long> _last_seq;
+    std::atomic<size_t> _received;
+    std::atomic<size_t> _disorder;
+    std::atomic<bool> _stop;
+    std::thread _thread;
+};
+
+// 乱序、超出sink丢弃计数的丢失或计数不一致时返回false
+bool dgram_bench(size_t thr_count, size_t msg_count)
+{
+    const std::string path = "./dgram_bench.sock";
+    FakeReceiver receiver(path, thr_count);
+    std::shared_ptr<mylog::DgramSink> sink;
+    {
+        std::unique_ptr<mylog::LoggerBuilder> builder(new mylog::LocalLoggerBuilder());
+        builder->buildFormatter("%m%n");
+        builder->buildLoggername("dgram_logger");
+        builder->buildLoggerType(mylog::LoggerType::LOGGER_ASYNC);
+        builder->buildEnableUnsafeAsync();
+        sink = std::make_shared<mylog::DgramSink>(path);
+        builder->buildSink(sink);
+        mylog::Logger::ptr logger = builder->build();
+        std::cout << "测试数据报日志: " << thr_count << "个线程,共" << msg_count << "条\n";
+        std::vector<std::thread> threads;
+        size_t msg_per_thr = msg_count / thr_count;
+        msg_count = msg_per_thr * thr_count;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < thr_count; ++i)
+        {
+            threads.emplace_back([&, i]()
+                                 {
+                for (size_t j = 0; j < msg_per_thr; ++j)
+                    logger->fatal("%lu %lu payload", i, j); });
+        }
+        for (auto &thr : threads)
+            thr.join();
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> cost = end - start;
+        std::cout << "\t生产耗时:" << cost.count() << "s\n";
+        // 日志器析构时异步线程把剩余数据发送完毕
+    }
+    // Unix数据报发送成功即已进入接收端的队列，等待接收端取完
+    for (int i = 0; i < 100 && receiver.received() < sink->sent(); ++i)
+        usleep(20 * 1000);
+    size_t received = receiver.received(), sent = sink->sent(), dropped = sink->dropped();
+    std::cout << "\t发送数量:" << sent << "条，sink丢弃:" << dropped << "条\n";
+    std::cout << "\t接收数量:" << received << "条\n";
+    std::cout << "\t丢失数量:" << msg_count - received << "条\n";
+    std::cout << "\t乱序数量:" << receiver.disorder() << "条\n";
+    bool ok = true;
+    if (receiver.disorder() != 0)
+    {
+        std::cout << "失败: 同一线程的日志乱序\n";
+        ok = false;
+    }
+    if (sent + dropped != msg_count)
+    {
+        std::cout << "失败: 发送数量与丢弃数量之和不等于日志条数\n";
+        ok = false;
+    }
+    if (msg_count - received > dropped)
+    {
+        std::cout << "失败: 丢失数量超过sink的丢弃计数\n";
+        ok = false;
+    }
+    return ok;
+}
+
+int main()
+{
+    return dgram_bench(4, 1000000) ? 0 : 1;
+}
@@ -0,0 +1,62 @@
+#include "../mylog/escape.hpp"
+#include <chrono>
+#include <iostream>
+#include <string>
+
+// 比较标量与SIMD扫描在干净/含控制字符的消息上的转义吞吐量
+void escape_bench(const std::string &name, mylog::Escape::ScanFunc scan, const std::string &msg, int flags, size_t rounds)
+{
+    mylog::Buffer out(64 * 1024);
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t total = 0;
+    for (size_t i = 0; i < rounds; ++i)
+    {
+        // 与Escape::escape相同的处理流程，只是指定了扫描函数
+        size_t pos = 0;
+        while (pos < msg.size())
+        {
+            size_t run = scan(msg.data() + pos, msg.size() - pos, flags);
+            out.push(msg.data() + pos, run);
+            pos += run;
+            if (pos < msg.size())
+            {
+                out.push('\\');
+                ++pos;
+            }
+        }
+        total += out.readAbleSize();
+        out.reset();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> cost = end - start;
+    std::cout << "\t" << name << ":\t" << (msg.size() * rounds) / cost.count() / 1024 / 1024 << "MB/s\n";
+}
+
+int main()
+{
+    const size_t rounds = 200000;
+    std::string clean(1000, 'A');
+    std::string dirty = clean;
+    for (size_t i = 0; i < dirty.size(); i += 100)
+        dirty[i] = '\n';
+    std::string json = dirty;
+    for (size_t i = 50; i < json.size(); i += 100)
+        json[i] = '"';
+    struct
+    {
+        const char *name;
+        const std::string *msg;
+        int flags;
+    } cases[] = {{"无需转义", &clean, mylog::ESCAPE_LINE}, {"每100字节一个换行", &dirty, mylog::ESCAPE_LINE}, {"JSON转义", &json, mylog::ESCAPE_JSON | mylog::ESCAPE_UTF8}};
+    for (auto &c : cases)
+    {
+        std::cout << c.name << "(" << c.msg->size() << "字节):\n";
+        escape_bench("scalar", mylog::Escape::scanScalar, *c.msg, c.flags, rounds);
+#ifdef ESCAPE_X86
+        escape_bench("sse2", mylog::Escape::scanSSE2, *c.msg, c.flags, rounds);
+        if (__builtin_cpu_supports("avx2"))
+            escape_bench("avx2", mylog::Escape::scanAVX2, *c.msg, c.flags, rounds);
+#endif
+    }
+    return 0;
+}
@@ -0,0 +1,169 @@
+#include "../mylog/escape.hpp"
+#include <cctype>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+    转义扫描函数的差异检查(make escape_check)：SSE2/AVX2扫描与标量扫描在随机输入上的结果必须一致，
+    重点覆盖向量边界：特殊字节位于15/16/31/32等位置、多字节UTF-8(合法或非法)跨越16/32字节边界、长度不足一个向量
+    同时检查ESCAPE_LINE(不校验UTF-8时)的转义结果可以还原为原文
+    任何一项失败时返回非0
+*/
+
+static size_t g_failed = 0;
+
+static void expect(bool ok, const std::string &what)
+{
+    std::cout << (ok ? "通过: " : "失败: ") << what << std::endl;
+    g_failed += !ok;
+}
+
+struct Scanner
+{
+    const char *name;
+    mylog::Escape::ScanFunc scan;
+};
+
+static std::vector<Scanner> scanners()
+{
+    std::vector<Scanner> list;
+#ifdef ESCAPE_X86
+    list.push_back({"sse2", mylog::Escape::scanSSE2});
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        list.push_back({"avx2", mylog::Escape::scanAVX2});
+    else
+        std::cout << "CPU不支持AVX2，跳过avx2\n";
+#endif
+    return list;
+}
+
+static std::string escaped(const std::string &data, int flags, mylog::Escape::ScanFunc scan)
+{
+    mylog::Buffer out(256);
+    mylog::Escape::escape(out, data.data(), data.size(), flags, scan);
+    return std::string(out.begin(), out.readAbleSize());
+}
+
+// 输入的各类片段：普通字符、控制字符、引号、反斜杠、合法和非法的多字节UTF-8
+static const char *const g_pieces[] = {
+    "a", "Z", " ", "\t", "\n", "\r", "\x01", "\x1f", "\x7f", "\"", "\\",
+    "\xc3\xa9", "\xe4\xb8\xad", "\xf0\x9f\x98\x80",   // 合法的2/3/4字节字符
+    "\xc3", "\xe4\xb8", "\xf0\x9f\x98", "\x80", "\xff", // 截断的序列和非法字节
+    "\xc0\xaf", "\xed\xa0\x80", "\xf4\x90\x80\x80",     // 过长编码、代理区、超出范围
+};
+static const size_t PIECE_COUNT = sizeof(g_pieces) / sizeof(g_pieces[0]);
+
+// 比较data从每个起始位置开始的扫描结果和完整的转义结果，返回不一致的次数
+static size_t compare(const std::string &data, const std::vector<Scanner> &list)
+{
+    size_t diff = 0;
+    for (int flags = 0; flags < 4; ++flags)
+    {
+        for (size_t off = 0; off <= data.size(); ++off)
+        {
+            size_t expected = mylog::Escape::scanScalar(data.data() + off, data.size() - off, flags);
+            for (auto &s : list)
+                diff += s.scan(data.data() + off, data.size() - off, flags) != expected;
+        }
+        std::string expected = escaped(data, flags, mylog::Escape::scanScalar);
+        for (auto &s : list)
+            diff += escaped(data, flags, s.scan) != expected;
+    }
+    return diff;
+}
+
+// 在长度为len的普通内容中把piece放在pos处
+static std::string place(size_t len, size_t pos, const std::string &piece)
+{
+    std::string data(len, 'x');
+    data.replace(std::min(pos, len), piece.size(), piece);
+    return data;
+}
+
+// 还原ESCAPE_LINE的转义结果
+static std::string unescapeLine(const std::string &text)
+{
+    std::string out;
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        if (text[i] != '\\' || i + 1 == text.size())
+        {
+            out.push_back(text[i]);
+            continue;
+        }
+        char c = text[++i];
+        if (c == 'n')
+            out.push_back('\n');
+        else if (c == 'r')
+            out.push_back('\r');
+        else if (c == 'x' && i + 2 < text.size() && isxdigit((unsigned char)text[i + 1]) && isxdigit((unsigned char)text[i + 2]))
+        {
+            out.push_back((char)std::stoi(text.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        }
+        else
+            out.push_back(c);
+    }
+    return out;
+}
+
+int main()
+{
+    std::vector<Scanner> list = scanners();
+    for (auto &s : list)
+        std::cout << "与标量扫描比较: " << s.name << "\n";
+
+    // 边界位置：每种片段放在向量边界前后
+    size_t diff = 0;
+    for (size_t len : {15, 16, 17, 31, 32, 33, 48, 64, 65})
+    {
+        for (size_t pos : {0, 1, 14, 15, 16, 17, 30, 31, 32, 33, 47, 63})
+        {
+            if (pos >= len)
+                continue;
+            for (size_t p = 0; p < PIECE_COUNT; ++p)
+                diff += compare(place(len, pos, g_pieces[p]), list);
+        }
+    }
+    expect(diff == 0, "特殊字节和UTF-8序列位于向量边界");
+
+    // 长度不足一个向量
+    diff = 0;
+    for (size_t len = 0; len < 33; ++len)
+    {
+        for (size_t pos = 0; pos < len; ++pos)
+        {
+            for (size_t p = 0; p < PIECE_COUNT; ++p)
+                diff += compare(place(len, pos, g_pieces[p]).substr(0, len), list);
+        }
+    }
+    expect(diff == 0, "长度不足一个向量");
+
+    // 随机拼接的输入
+    std::mt19937 rng(20261019);
+    diff = 0;
+    size_t irreversible = 0;
+    for (int round = 0; round < 3000; ++round)
+    {
+        std::string data;
+        size_t target = rng() % 200;
+        while (data.size() < target)
+        {
+            // 普通字符占多数，使扫描能跨过整个向量
+            if (rng() % 3)
+                data.append(rng() % 40, 'a' + rng() % 26);
+            else
+                data += g_pieces[rng() % PIECE_COUNT];
+        }
+        diff += compare(data, list);
+        irreversible += unescapeLine(escaped(data, mylog::ESCAPE_LINE, mylog::Escape::scanScalar)) != data;
+    }
+    expect(diff == 0, "随机输入与标量扫描一致");
+    expect(irreversible == 0, "ESCAPE_LINE的转义结果可以还原");
+
+    std::cout << (g_failed ? "存在失败的检查\n" : "全部通过\n");
+    return g_failed ? 1 : 0;
+}
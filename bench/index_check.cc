@@ -0,0 +1,210 @@
+#include "../mylog/mylog.h"
+#include <dirent.h>
+#include <signal.h>
+#include <sstream>
+#include <sys/resource.h>
+
+/*
+    稀疏索引的检查(make index_check)：通过RollBySizeSink写入带元信息的日志并生成索引，
+    再按时间、等级和日志器查询，与逐行扫描的结果比较：
+        匹配的每一行都必须落在查询选中的块中(不能漏判)，块的偏移与日志文件一致，并且查询确实跳过了部分块
+        同一地址上的日志器名称改变后(日志器销毁后地址被重用)，新名称也能查到
+        文件大小超过限制导致部分写入时，索引只计入实际写入的字节，之后的块偏移仍与文件一致，写入失败被计数
+    任何一项失败时返回非0
+*/
+
+static size_t g_failed = 0;
+
+static void expect(bool ok, const std::string &what)
+{
+    std::cout << (ok ? "通过: " : "失败: ") << what << std::endl;
+    g_failed += !ok;
+}
+
+struct Line
+{
+    int64_t time;
+    mylog::LogLevel::value level;
+    std::string logger;
+    size_t offset;
+};
+
+static const char *const g_loggers[] = {"app.db", "app.net", "app.auth", "batch"};
+
+// 写入count条日志，每批64条；时间每256条加1秒，等级和日志器按序号循环
+static void writeLog(mylog::RollBySizeSink &sink, std::vector<Line> &lines, size_t count, int64_t base_time)
+{
+    std::string name; // 所有记录的日志器名称都指向这个对象，名称随批次改变
+    size_t offset = 0;
+    for (size_t first = 0; first < count; first += 64)
+    {
+        std::vector<std::string> texts;
+        std::vector<mylog::LogRecord> records;
+        name = g_loggers[(first / 64) % 4];
+        for (size_t i = first; i < std::min(count, first + 64); ++i)
+        {
+            mylog::LogLevel::value level = (mylog::LogLevel::value)(1 + i % 5);
+            int64_t time = base_time + i / 256;
+            std::ostringstream oss;
+            oss << time << " [" << mylog::LogLevel::toString(level) << "][" << name << "] message " << i << " "
+                << std::string(40 + i % 60, 'x') << "\n";
+            texts.push_back(oss.str());
+            records.push_back({texts.back().size(), (time_t)time, level, &name, 1, &name});
+            lines.push_back({time, level, name, offset});
+            offset += texts.back().size();
+        }
+        std::vector<struct iovec> iov;
+        for (auto &text : texts)
+            iov.push_back({&text[0], text.size()});
+        mylog::LogBatch batch = {iov.data(), (int)iov.size(), records.data(), records.size()};
+        sink.log(batch);
+    }
+}
+
+// 以prefix开头的日志文件只有一个(不包括索引和预先创建的下一个文件)，返回它的路径
+static std::string findLog(const std::string &dir, const std::string &prefix)
+{
+    DIR *d = opendir(dir.c_str());
+    std::string found;
+    for (struct dirent *ent = d ? readdir(d) : nullptr; ent; ent = readdir(d))
+    {
+        std::string name = ent->d_name;
+        if (name.compare(0, prefix.size(), prefix) == 0 && name.find(INDEX_SUFFIX) == std::string::npos &&
+            name.find(".tmp") == std::string::npos)
+            found = dir + name;
+    }
+    if (d)
+        closedir(d);
+    return found;
+}
+
+static bool lineMatches(const Line &line, const mylog::IndexReader::Query &query)
+{
+    return line.time >= query.begin_time && line.time <= query.end_time && line.level >= query.level &&
+           (query.logger.empty() || line.logger == query.logger);
+}
+
+// 块首尾相接且覆盖整个日志文件
+static bool tiles(const std::vector<mylog::IndexBlock> &blocks, const std::string &log_path, size_t &records)
+{
+    struct stat st;
+    bool contiguous = stat(log_path.c_str(), &st) == 0;
+    size_t end = 0;
+    records = 0;
+    for (auto &block : blocks)
+    {
+        contiguous = contiguous && block.offset == end;
+        end = block.offset + block.length;
+        records += block.records;
+    }
+    return contiguous && end == (size_t)st.st_size;
+}
+
+// 文件大小限制使写入在一条日志的中间停止，之后的写入都失败
+static void partialWrite(const std::string &dir, int64_t base_time)
+{
+    signal(SIGXFSZ, SIG_IGN);
+    std::vector<Line> lines;
+    size_t errors;
+    {
+        mylog::RollBySizeSink sink(dir + "part-", 1024 * 1024 * 1024, true);
+        writeLog(sink, lines, 1000, base_time);
+        struct stat st;
+        struct rlimit old, lim;
+        if (stat(findLog(dir, "part-").c_str(), &st) != 0 || getrlimit(RLIMIT_FSIZE, &old) != 0)
+        {
+            expect(false, "部分写入");
+            return;
+        }
+        lim = old;
+        lim.rlim_cur = st.st_size + 3001;
+        setrlimit(RLIMIT_FSIZE, &lim);
+        writeLog(sink, lines, 1000, base_time + 100);
+        setrlimit(RLIMIT_FSIZE, &old);
+        errors = sink.writeErrors();
+    }
+    std::vector<mylog::IndexBlock> blocks;
+    std::string log_path = findLog(dir, "part-");
+    size_t records;
+    bool ok = mylog::IndexReader::load(log_path, blocks) && tiles(blocks, log_path, records);
+    expect(ok && records > 1000 && records < 1100, "部分写入时索引只计入实际写入的部分");
+    expect(errors > 0, "写入失败被计数");
+}
+
+// 匹配的行都在选中的块中时返回true，skipped为未选中的块数
+static bool checkQuery(const std::vector<mylog::IndexBlock> &blocks, const std::vector<Line> &lines,
+                       const mylog::IndexReader::Query &query, size_t &skipped)
+{
+    std::vector<bool> selected(blocks.size());
+    skipped = 0;
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        selected[i] = mylog::IndexReader::match(blocks[i], query);
+        skipped += !selected[i];
+    }
+    for (auto &line : lines)
+    {
+        if (!lineMatches(line, query))
+            continue;
+        size_t b = 0;
+        while (b < blocks.size() && blocks[b].offset + blocks[b].length <= line.offset)
+            ++b;
+        if (b == blocks.size() || !selected[b])
+            return false;
+    }
+    return true;
+}
+
+int main()
+{
+    std::string dir = "./index_check." + std::to_string(getpid()) + "/";
+    std::vector<Line> lines;
+    const int64_t base_time = 1700000000;
+    {
+        mylog::RollBySizeSink sink(dir + "idx-", 1024 * 1024 * 1024, true);
+        writeLog(sink, lines, 20000, base_time);
+    }
+    std::string log_path = findLog(dir, "idx-");
+    std::vector<mylog::IndexBlock> blocks;
+    expect(!log_path.empty() && mylog::IndexReader::load(log_path, blocks) && blocks.size() > 4, "生成索引");
+
+    // 块首尾相接，覆盖整个日志文件，记录条数一致
+    size_t records;
+    expect(tiles(blocks, log_path, records) && records == lines.size(), "块的偏移和长度与日志文件一致");
+
+    mylog::IndexReader::Query by_time;
+    by_time.begin_time = base_time + 20;
+    by_time.end_time = base_time + 30;
+    mylog::IndexReader::Query by_level;
+    by_level.level = mylog::LogLevel::value::FATAL;
+    mylog::IndexReader::Query by_logger;
+    by_logger.logger = "app.auth";
+    mylog::IndexReader::Query combined = by_time;
+    combined.level = mylog::LogLevel::value::ERROR;
+    combined.logger = "batch";
+    size_t skipped;
+    expect(checkQuery(blocks, lines, by_time, skipped) && skipped > 0, "按时间查询");
+    expect(checkQuery(blocks, lines, by_level, skipped), "按等级查询");
+    // 日志器名称存放在同一个对象中，按地址缓存哈希结果时后面的名称会漏判
+    bool all_loggers = true;
+    for (const char *name : g_loggers)
+    {
+        mylog::IndexReader::Query query;
+        query.logger = name;
+        all_loggers = all_loggers && checkQuery(blocks, lines, query, skipped);
+    }
+    expect(all_loggers, "按日志器查询(名称所在的地址相同)");
+    expect(checkQuery(blocks, lines, by_logger, skipped), "按日志器查询");
+    expect(checkQuery(blocks, lines, combined, skipped) && skipped > 0, "组合条件查询");
+    mylog::IndexReader::Query missing;
+    missing.logger = "no.such.logger";
+    checkQuery(blocks, lines, missing, skipped);
+    expect(skipped > 0, "不存在的日志器跳过块");
+
+    partialWrite(dir, base_time);
+
+    if (system(("rm -rf " + dir).c_str()) != 0)
+        std::cout << "清理失败: " << dir << std::endl;
+    std::cout << (g_failed ? "存在失败的检查\n" : "全部通过\n");
+    return g_failed ? 1 : 0;
+}
@@ -0,0 +1,136 @@
+#include "../mylog/mylog.h"
+#include <sstream>
+
+/*
+    日志器生命周期和层级关系的回归检查，建议用AddressSanitizer编译(make check)：
+        带等级过滤的落地方向的异步日志器，写日志后不调用flush直接销毁
+        使用共享线程池的异步日志器，其没有落地方向的子日志器的日志由它输出
+        多个线程写日志的同时反复替换格式，替换下来的格式化方案在仍被使用时不能释放
+    任何一项失败时返回非0
+*/
+
+// 只保存收到的日志，供检查内容；delay_us不为0时每次写入前等待，使异步缓冲区中积压数据
+class MemorySink : public mylog::LogSink
+{
+public:
+    MemorySink(int delay_us = 0) : _delay_us(delay_us) {}
+    void log(const char *data, const size_t &len)
+    {
+        if (_delay_us)
+            usleep(_delay_us);
+        std::unique_lock<std::mutex> lock(_mutex);
+        _data.append(data, len);
+    }
+    std::string data()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        return _data;
+    }
+
+private:
+    int _delay_us;
+    std::mutex _mutex;
+    std::string _data;
+};
+
+static size_t g_failed = 0;
+
+static void expect(bool ok, const std::string &what)
+{
+    std::cout << (ok ? "通过: " : "失败: ") << what << std::endl;
+    g_failed += !ok;
+}
+
+static size_t count(const std::string &data, const std::string &word)
+{
+    size_t n = 0;
+    for (size_t pos = data.find(word); pos != std::string::npos; pos = data.find(word, pos + word.size()))
+        ++n;
+    return n;
+}
+
+// 异步日志器析构时由工作线程处理剩余的数据，按落地方向筛选记录用到的成员此时必须仍然有效
+static void destroyWithFilteredSink()
+{
+    auto all = std::make_shared<MemorySink>(1000);
+    auto errors = std::make_shared<MemorySink>();
+    errors->setLevel(mylog::LogLevel::value::ERROR);
+    {
+        std::unique_ptr<mylog::LoggerBuilder> builder(new mylog::LocalLoggerBuilder());
+        builder->buildLoggername("check.filtered");
+        builder->buildLoggerType(mylog::LoggerType::LOGGER_ASYNC);
+        builder->buildFormatter("%p %m%n");
+        builder->buildSink(all);
+        builder->buildSink(errors);
+        mylog::Logger::ptr logger = builder->build();
+        // 写日志的速度快于落地，析构时缓冲区中还有数据
+        for (int i = 0; i < 1000; ++i)
+        {
+            logger->info("info %d", i);
+            logger->error("error %d", i);
+        }
+    }
+    expect(count(all->data(), "\n") == 2000 && count(errors->data(), "ERROR") == 1000 && count(errors->data(), "INFO") == 0,
+           "带等级过滤的异步日志器销毁前处理完剩余日志");
+}
+
+// 共享线程池按记录的输出者分发，子日志器的记录不能因为找不到自己的回调而丢失
+static void pooledParent()
+{
+    auto sink = std::make_shared<MemorySink>();
+    std::unique_ptr<mylog::LoggerBuilder> builder(new mylog::GlobalLoggerBuilder());
+    builder->buildLoggername("check.pool");
+    builder->buildLoggerType(mylog::LoggerType::LOGGER_ASYNC);
+    builder->buildLooperPool(std::make_shared<mylog::LooperPool>(1));
+    builder->buildFormatter("[%c]%m%n");
+    builder->buildSink(sink);
+    mylog::Logger::ptr parent = builder->build();
+    mylog::Logger::ptr child = mylog::LoggerManager::getInstance().getOrCreateLogger("check.pool.db");
+    mylog::Logger::ptr grandchild = mylog::LoggerManager::getInstance().getOrCreateLogger("check.pool.db.conn");
+    parent->info("from parent");
+    child->info("from child");
+    grandchild->info("from grandchild");
+    parent->flush();
+    std::string data = sink->data();
+    expect(count(data, "[check.pool]from parent\n") == 1 && count(data, "[check.pool.db]from child\n") == 1 &&
+               count(data, "[check.pool.db.conn]from grandchild\n") == 1,
+           "共享线程池的异步日志器输出子日志器的日志");
+}
+
+// 替换下来的格式化方案在没有使用者时释放，写日志的线程不能访问到已释放的方案(AddressSanitizer检查)
+static void replaceFormatterWhileLogging()
+{
+    auto sink = std::make_shared<MemorySink>();
+    std::unique_ptr<mylog::LoggerBuilder> builder(new mylog::LocalLoggerBuilder());
+    builder->buildLoggername("check.reload");
+    builder->buildFormatter("%m%n");
+    builder->buildSink(sink);
+    mylog::Logger::ptr logger = builder->build();
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&]()
+                             {
+                                 while (!stop)
+                                     logger->info("reload"); });
+    }
+    for (int i = 0; i < 2000; ++i)
+        logger->setFormatter(std::make_shared<mylog::Formatter>(i % 2 ? "[%p]%m%n" : "%m%n"));
+    stop = true;
+    for (auto &thread : threads)
+        thread.join();
+    logger->setFormatter(std::make_shared<mylog::Formatter>("<%m>%n"));
+    logger->info("last");
+    std::string data = sink->data();
+    expect(data.size() > 7 && data.compare(data.size() - 7, 7, "<last>\n") == 0, "写日志时反复替换格式");
+}
+
+int main()
+{
+    destroyWithFilteredSink();
+    pooledParent();
+    replaceFormatterWhileLogging();
+    std::cout << (g_failed ? "存在失败的检查\n" : "全部通过\n");
+    return g_failed ? 1 : 0;
+}
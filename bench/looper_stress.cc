@@ -0,0 +1,178 @@
+#include "../mylog/looper.hpp"
+#include <csignal>
+#include <random>
+#include <sstream>
+
+/*
+    AsyncLooper的压力测试：多个生产者以push、tryPush、pushOrNotify混合写入带序号的记录(偶尔有超过缓冲区大小的记录)，
+    期间随机调用flush并在生产者仍在写入时调用stop，检查：
+        每个生产者的记录按序到达，没有丢失或重复
+        flush返回时之前写入的记录已经处理
+        任何一轮超过时限视为死锁
+    可以用ThreadSanitizer编译(make stress_tsan)检查数据竞争
+*/
+
+#define STRESS_ROUND_TIMEOUT 60 // 每轮的最长时间(秒)
+
+struct Config
+{
+    mylog::AsyncType type;
+    size_t producers;
+    size_t records;     // 每个生产者的记录数
+    size_t buffer_size; // 较小的缓冲区使生产者频繁等待
+    bool early_stop;    // 生产者写到一半时调用stop
+};
+
+class Checker
+{
+public:
+    Checker(size_t producers) : _next(producers), _errors(0)
+    {
+        for (auto &n : _next)
+            n = 0;
+    }
+    // 工作线程中调用(stop之后也可能在生产者线程中调用)
+    void consume(mylog::Buffer &buf)
+    {
+        const char *data = buf.begin();
+        for (size_t i = 0; i < buf.recordCount(); ++i)
+        {
+            const mylog::LogRecord &rec = buf.records()[i];
+            unsigned long p, seq;
+            if (sscanf(std::string(data, rec._len).c_str(), "%lu:%lu", &p, &seq) != 2 || p >= _next.size())
+            {
+                report("无法解析的记录");
+            }
+            else if (seq != _next[p].load())
+            {
+                std::ostringstream ss;
+                ss << "生产者" << p << "的记录乱序或丢失: 期望" << _next[p].load() << " 收到" << seq;
+                report(ss.str());
+            }
+            else
+                _next[p].store(seq + 1);
+            data += rec._len;
+        }
+    }
+    size_t next(size_t p) { return _next[p].load(); }
+    size_t errors() { return _errors; }
+    void report(const std::string &msg)
+    {
+        if (_errors++ < 10)
+            std::cout << "\t错误: " << msg << std::endl;
+    }
+
+private:
+    std::vector<std::atomic<size_t>> _next; // 每个生产者期望的下一个序号
+    std::atomic<size_t> _errors;
+};
+
+static void onTimeout(int)
+{
+    const char msg[] = "超时，可能发生了死锁\n";
+    write(STDOUT_FILENO, msg, sizeof(msg) - 1);
+    _exit(1);
+}
+
+static void producer(mylog::AsyncLooper &looper, Checker &checker, const Config &conf, size_t p)
+{
+    std::mt19937 rng(p * 7919 + 1);
+    char line[64];
+    std::string large;
+    for (size_t seq = 0; seq < conf.records; ++seq)
+    {
+        int len = snprintf(line, sizeof(line), "%zu:%zu\n", p, seq);
+        struct iovec iov = {line, (size_t)len};
+        if (rng() % 500 == 0)
+        {
+            // 超过缓冲区大小的记录，安全模式下只能写入空缓冲区
+            large.assign(line, len - 1);
+            large.append(conf.buffer_size + 100, ' ');
+            large.push_back('\n');
+            iov = {&large[0], large.size()};
+            len = large.size();
+        }
+        mylog::LogRecord record = {(size_t)len, 0, mylog::LogLevel::value::INFO, nullptr, ~0ULL};
+        switch (rng() % 4)
+        {
+        case 0:
+            while (!looper.tryPush(&iov, 1, record))
+                std::this_thread::yield();
+            break;
+        case 1:
+        {
+            // 排队时必须等通知之后再写下一条，否则后面的记录可能先于排队的记录写入
+            std::atomic<bool> done(false);
+            if (!looper.pushOrNotify(&iov, 1, record, [&done]()
+                                     { done = true; }))
+            {
+                while (!done)
+                    std::this_thread::yield();
+            }
+            break;
+        }
+        default:
+            looper.push(&iov, 1, record);
+        }
+        if (rng() % 1000 == 0)
+        {
+            looper.flush();
+            if (checker.next(p) < seq + 1)
+                checker.report("flush返回时之前的记录还没有处理");
+        }
+    }
+}
+
+static bool runRound(const Config &conf)
+{
+    Checker checker(conf.producers);
+    alarm(STRESS_ROUND_TIMEOUT);
+    {
+        mylog::AsyncLooper looper(std::bind(&Checker::consume, &checker, std::placeholders::_1), conf.type, conf.buffer_size);
+        std::vector<std::thread> threads;
+        for (size_t p = 0; p < conf.producers; ++p)
+            threads.emplace_back(producer, std::ref(looper), std::ref(checker), std::cref(conf), p);
+        if (conf.early_stop)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+            looper.stop();
+        }
+        for (auto &t : threads)
+            t.join();
+        looper.flush();
+    }
+    alarm(0);
+    for (size_t p = 0; p < conf.producers; ++p)
+    {
+        if (checker.next(p) != conf.records)
+        {
+            std::ostringstream ss;
+            ss << "生产者" << p << "只处理了" << checker.next(p) << "/" << conf.records << "条";
+            checker.report(ss.str());
+        }
+    }
+    return checker.errors() == 0;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t rounds = argc > 1 ? strtoul(argv[1], nullptr, 10) : 20;
+    signal(SIGALRM, onTimeout);
+    size_t failed = 0;
+    for (size_t r = 0; r < rounds; ++r)
+    {
+        Config conf;
+        conf.type = r % 2 ? mylog::AsyncType::ASYNC_UNSAFE : mylog::AsyncType::ASYNC_SAFE;
+        conf.producers = 2 + r % 7;
+        conf.records = 20000;
+        conf.buffer_size = (r % 3 == 0) ? 256 : 64 * 1024;
+        conf.early_stop = r % 4 == 3;
+        bool ok = runRound(conf);
+        std::cout << "第" << r << "轮 " << (conf.type == mylog::AsyncType::ASYNC_SAFE ? "SAFE" : "UNSAFE")
+                  << " 生产者:" << conf.producers << " 缓冲区:" << conf.buffer_size << (conf.early_stop ? " 提前stop" : "")
+                  << (ok ? " 通过" : " 失败") << std::endl;
+        failed += !ok;
+    }
+    std::cout << (failed ? "存在失败的轮次\n" : "全部通过\n");
+    return failed ? 1 : 0;
+}
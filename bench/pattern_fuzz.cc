@@ -0,0 +1,300 @@
+#include "../mylog/format.hpp"
+#include "../mylog/escape.hpp"
+#include <random>
+
+/*
+    Formatter格式解析的模糊测试：用一个按文档逐项实现、不做任何优化的参考格式化器作为对照，
+    对任意输入检查：
+        Formatter::check与参考实现对格式是否正确的判断一致，且不会崩溃
+        格式正确时，Formatter逐项格式化、分段格式化(format(buf, msg, iov))以及绑定日志器名称后的结果都与参考实现相同
+    %p{color}按文档中各等级的颜色在参考实现中重新拼出；%m{...}的转义以标量扫描(Escape::scanScalar)的结果为准
+    可以作为libFuzzer的目标编译：clang++ -g -fsanitize=fuzzer,address -DMYLOG_LIBFUZZER pattern_fuzz.cc
+    直接编译时随机生成格式(参数为轮数和随机种子)
+*/
+
+static const std::string LOGGER_NAME = "fuzz.logger";
+static const int64_t MSG_NS = 1700000000123456789LL;
+// 格式化时的诊断上下文，参考实现直接使用这张表
+static const std::vector<std::pair<std::string, std::string>> MDC_ENTRIES = {{"req", "42"}, {"user", "bob smith"}, {"n", ""}};
+
+// 参考实现：一项一项地解析和输出
+class RefFormatter
+{
+public:
+    // 格式有误返回false
+    static bool format(const std::string &pattern, const mylog::logMsg &msg, std::string &out)
+    {
+        size_t pos = 0;
+        while (pos < pattern.size())
+        {
+            char ch = pattern[pos];
+            if (ch != '%')
+            {
+                out.push_back(ch);
+                ++pos;
+                continue;
+            }
+            if (pos + 1 == pattern.size())
+                return false;
+            if (pattern[pos + 1] == '%')
+            {
+                out.push_back('%');
+                pos += 2;
+                continue;
+            }
+            ++pos;
+            bool left = false;
+            if (pattern[pos] == '-')
+                left = true, ++pos;
+            size_t width = 0;
+            while (pos < pattern.size() && isdigit((unsigned char)pattern[pos]))
+            {
+                width = width * 10 + (pattern[pos++] - '0');
+                if (width > FORMAT_MAX_WIDTH)
+                    return false;
+            }
+            if (pos == pattern.size())
+                return false;
+            char key = pattern[pos++];
+            std::string sub;
+            if (pos < pattern.size() && pattern[pos] == '{')
+            {
+                size_t end = pattern.find('}', pos);
+                if (end == std::string::npos)
+                    return false;
+                sub = pattern.substr(pos + 1, end - pos - 1);
+                pos = end + 1;
+            }
+            std::string item;
+            switch (key)
+            {
+            case 'd':
+                item = time(sub.empty() ? "%H:%M:%S" : sub, msg);
+                break;
+            case 't':
+                item.assign(msg._tid->str, msg._tid->len);
+                break;
+            case 'c':
+                item = msg._logger;
+                break;
+            case 'f':
+                item = msg._file;
+                break;
+            case 'l':
+                item = std::to_string(msg._line);
+                break;
+            case 'p':
+                item = pad(mylog::LogLevel::toString(msg._level), width, left);
+                if (sub == "color" && color(msg._level))
+                    item = color(msg._level) + item + "\033[0m"; // 颜色包在填充后的名称外面
+                break;
+            case 'T':
+                item = "\t";
+                break;
+            case 'm':
+                // 子格式只能是escape或json，可追加",utf8"
+                if (!sub.empty() && sub != "escape" && sub != "json" && sub != "escape,utf8" && sub != "json,utf8")
+                    return false;
+                item = sub.empty() ? msg._payload : escape(msg._payload, sub);
+                break;
+            case 'n':
+                item = "\n";
+                break;
+            case 'X':
+                for (auto &entry : MDC_ENTRIES)
+                {
+                    if (sub.empty())
+                        item += (item.empty() ? "" : " ") + entry.first + "=" + entry.second;
+                    else if (entry.first == sub)
+                        item = entry.second;
+                }
+                break;
+            default:
+                return false;
+            }
+            out += pad(item, width, left);
+        }
+        return true;
+    }
+
+private:
+    static std::string pad(const std::string &item, size_t width, bool left)
+    {
+        if (item.size() >= width)
+            return item;
+        return left ? item + std::string(width - item.size(), ' ') : std::string(width - item.size(), ' ') + item;
+    }
+    // 各等级的ANSI颜色，DEBUG青色、INFO绿色、WARN黄色、ERROR红色、FATAL加粗红色，其余不着色
+    static const char *color(mylog::LogLevel::value level)
+    {
+        switch (level)
+        {
+        case mylog::LogLevel::value::DEBUG:
+            return "\033[36m";
+        case mylog::LogLevel::value::INFO:
+            return "\033[32m";
+        case mylog::LogLevel::value::WARN:
+            return "\033[33m";
+        case mylog::LogLevel::value::ERROR:
+            return "\033[31m";
+        case mylog::LogLevel::value::FATAL:
+            return "\033[1;31m";
+        default:
+            return nullptr;
+        }
+    }
+    // 转义固定使用标量扫描，不受运行时选择的SIMD扫描影响
+    static std::string escape(const std::string &payload, const std::string &sub)
+    {
+        int flags = sub.compare(0, 4, "json") == 0 ? mylog::ESCAPE_JSON : mylog::ESCAPE_LINE;
+        if (sub.find(",utf8") != std::string::npos)
+            flags |= mylog::ESCAPE_UTF8;
+        mylog::Buffer buf(256);
+        mylog::Escape::escape(buf, payload.data(), payload.size(), flags, mylog::Escape::scanScalar);
+        return std::string(buf.begin(), buf.readAbleSize());
+    }
+    // %N、%1N~%9N为秒以下部分，"%%"及其余转换原样交给strftime
+    static std::string time(const std::string &fmt, const mylog::logMsg &msg)
+    {
+        struct tm t;
+        localtime_r(&msg._ctime, &t);
+        std::string out, run;
+        for (size_t i = 0; i < fmt.size(); ++i)
+        {
+            int digits = 0;
+            size_t skip = 0;
+            if (fmt[i] == '%' && i + 1 < fmt.size() && fmt[i + 1] == 'N')
+                digits = 9, skip = 1;
+            else if (fmt[i] == '%' && i + 2 < fmt.size() && fmt[i + 1] >= '1' && fmt[i + 1] <= '9' && fmt[i + 2] == 'N')
+                digits = fmt[i + 1] - '0', skip = 2;
+            if (digits == 0)
+            {
+                run.push_back(fmt[i]);
+                if (fmt[i] == '%' && i + 1 < fmt.size())
+                    run.push_back(fmt[++i]);
+                continue;
+            }
+            out += strftime(run, t);
+            run.clear();
+            char frac[16];
+            snprintf(frac, sizeof(frac), "%09lld", (long long)(msg._ns % 1000000000));
+            out.append(frac, digits);
+            i += skip;
+        }
+        return out + strftime(run, t);
+    }
+    static std::string strftime(const std::string &fmt, const struct tm &t)
+    {
+        if (fmt.empty())
+            return "";
+        std::vector<char> buf(64 + fmt.size() * 128);
+        size_t len = ::strftime(buf.data(), buf.size(), fmt.c_str(), &t);
+        return std::string(buf.data(), len);
+    }
+};
+
+static std::string join(const struct iovec *iov, int cnt)
+{
+    std::string out;
+    for (int i = 0; i < cnt; ++i)
+        out.append(static_cast<const char *>(iov[i].iov_base), iov[i].iov_len);
+    return out;
+}
+
+static void mismatch(const std::string &pattern, const char *what, const std::string &expect, const std::string &actual)
+{
+    std::cout << "结果不一致(" << what << ")\n\t格式: \"" << pattern << "\"\n\t参考: \"" << expect << "\"\n\t实际: \"" << actual << "\"" << std::endl;
+    abort();
+}
+
+static void checkPattern(const std::string &pattern)
+{
+    static const std::string short_payload = "hello";
+    static const std::string long_payload(200, 'x'); // 超过FORMAT_SPAN_MIN，分段格式化时作为单独的一段
+    // 需要转义的内容：控制字符、引号、反斜杠、合法和非法的UTF-8
+    static const std::string special_payload = "a\nb\r\tc\x01\x1f\x7f \"q\" \\ \xc3\xa9\xe4\xb8\xad\xf0\x9f\x98\x80 \xff\xc3 \xed\xa0\x80";
+    struct Case
+    {
+        mylog::LogLevel::value level;
+        const std::string *payload;
+    };
+    static const Case cases[] = {{mylog::LogLevel::value::WARN, &short_payload},
+                                 {mylog::LogLevel::value::DEBUG, &long_payload},
+                                 {mylog::LogLevel::value::FATAL, &special_payload},
+                                 {mylog::LogLevel::value::INFO, &special_payload}};
+    static bool mdc_ready = false;
+    if (!mdc_ready)
+    {
+        for (auto &entry : MDC_ENTRIES)
+            mylog::MDC::put(entry.first, entry.second);
+        mdc_ready = true;
+    }
+    std::string error;
+    bool valid = mylog::Formatter::check(pattern, &error);
+    for (const Case &c : cases)
+    {
+        mylog::logMsg msg(c.level, 42, "fuzz.cc", LOGGER_NAME, *c.payload, MSG_NS, &mylog::util::Thread::current(), &mylog::MDC::view());
+        std::string expect;
+        bool ref_valid = RefFormatter::format(pattern, msg, expect);
+        if (valid != ref_valid)
+            mismatch(pattern, "格式是否正确", ref_valid ? "正确" : "有误", valid ? "正确" : error);
+        if (!valid)
+            continue;
+        mylog::Formatter formatter(pattern);
+        mylog::Buffer buf(FORMAT_BUFFER_SIZE);
+        formatter.format(buf, msg);
+        std::string actual(buf.begin(), buf.readAbleSize());
+        if (actual != expect)
+            mismatch(pattern, "逐项格式化", expect, actual);
+        mylog::Formatter::ptr bound = formatter.bind(LOGGER_NAME);
+        buf.reset();
+        struct iovec iov[FORMAT_MAX_IOV];
+        int cnt = bound->format(buf, msg, iov, FORMAT_MAX_IOV);
+        actual = join(iov, cnt);
+        if (actual != expect)
+            mismatch(pattern, "分段格式化", expect, actual);
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    checkPattern(std::string(reinterpret_cast<const char *>(data), size));
+    return 0;
+}
+
+#ifndef MYLOG_LIBFUZZER
+// 按格式的语法组合片段，比完全随机的字节更容易覆盖到各种分支
+static std::string randomPattern(std::mt19937 &rng)
+{
+    static const char *pieces[] = {"%", "%%", "-", "5", "12", "d", "t", "c", "f", "l", "p", "T", "m", "n", "{", "}", "[", "]", " ",
+                                   "%d{%H:%M:%S}", "%d{%3N}", "%d{%6N}", "%d{%N}", "%d{%Y-%m-%d %H:%M:%S.%3N}", "%d{}", "%d{%%N}",
+                                   "%d{%-d %_H %10Y}", "%d{%c %x %X %A %B}", "%p{color}", "%-7p{color}", "%9p{color}", "%p{bold}", "%m{json,utf8}", "%m{escape}",
+                                   "%m{json}", "%m{escape,utf8}", "%m{utf8}", "%m{bogus}", "%m{json,}", "%m{escape,json}", "%m{}", "%-30m{json}", "%300m{escape}",
+                                   "%-5p", "%10c", "%-20m", "%99999t", "%x", "%X", "%X{req}", "%X{user}", "%-12X{n}", "%X{nope}", "%40X", "%{", "%-", "%5", "字"};
+    std::string pattern;
+    size_t count = rng() % 12;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (rng() % 8 == 0)
+            pattern.push_back((char)(rng() % 256));
+        else
+            pattern += pieces[rng() % (sizeof(pieces) / sizeof(pieces[0]))];
+    }
+    return pattern;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t rounds = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200000;
+    unsigned seed = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1;
+    std::mt19937 rng(seed);
+    const char *corpus[] = {"", "%", "%%", "%-", "%5", "%-5", "%q", "%d{", "%d{}", "%d{%H", FORMAT_DEFAULT_PATTERN,
+                            "%d{%Y%m%d %H:%M:%S.%9N}%-10p%20c%m%n", "100%%done%n", "%1025m", "%1024m"};
+    for (const char *pattern : corpus)
+        checkPattern(pattern);
+    for (size_t i = 0; i < rounds; ++i)
+        checkPattern(randomPattern(rng));
+    std::cout << "格式解析模糊测试通过: " << rounds << "个随机格式" << std::endl;
+    return 0;
+}
+#endif
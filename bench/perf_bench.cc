@@ -0,0 +1,369 @@
+#include "../mylog/mylog.h"
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <sys/ioctl.h>
+#include <linux/perf_event.h>
+
+/*
+    按调用统计硬件/软件计数器(perf_event_open)：指令数、周期数、缓存未命中、上下文切换、缺页、CPU时间，
+    分别测量同步日志器的写入、异步日志器的生产者(push)以及异步线程(交换缓冲区并写入落地方向)三条路径，
+    并与保存的基准比较，超出容差时返回非0
+        ./perf -u               在本机生成基准perf_baseline.txt(基准与机器相关，不随代码提交，在运行比较的主机上生成)
+        ./perf                  与perf_baseline.txt比较(容差默认20%)
+        ./perf -t 0.1           指定容差
+        ./perf -b file -u       指定基准文件
+        ./perf -r 5             测量轮数，各计数器取最小值(默认5轮)
+    CPU时间和周期数受频率、负载影响，每次测量之前先测量一段固定的校准计算(calibration)，
+    这两项按与校准值的比例(task-clock-ns-rel、cycles-rel)比较，其余计数器直接比较
+    异步日志器使用非安全模式并预留足够的缓冲区，生产者不会因缓冲区满而阻塞，push路径单独测量
+    当前环境不支持的计数器(例如虚拟机中的硬件计数器)显示为n/a，不参与比较
+*/
+
+struct Metric
+{
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+};
+static const Metric g_metrics[] = {
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+    {"page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+    {"task-clock-ns", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+};
+static const size_t METRIC_COUNT = sizeof(g_metrics) / sizeof(g_metrics[0]);
+
+// 一个线程上的一组计数器，各计数器单独打开，不支持的计数器不影响其他计数器
+class PerfCounters
+{
+public:
+    PerfCounters(pid_t tid = 0)
+    {
+        for (size_t i = 0; i < METRIC_COUNT; ++i)
+        {
+            struct perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = g_metrics[i].type;
+            attr.config = g_metrics[i].config;
+            attr.disabled = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            _fds[i] = syscall(__NR_perf_event_open, &attr, tid, -1, -1, 0);
+        }
+    }
+    ~PerfCounters()
+    {
+        for (int fd : _fds)
+        {
+            if (fd >= 0)
+                close(fd);
+        }
+    }
+    void start()
+    {
+        for (int fd : _fds)
+        {
+            if (fd >= 0)
+            {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+    }
+    void stop()
+    {
+        for (int fd : _fds)
+        {
+            if (fd >= 0)
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    // 各计数器的值除以calls，不可用时为-1；计数器被轮换时按运行时间比例换算
+    void read(size_t calls, double values[METRIC_COUNT])
+    {
+        for (size_t i = 0; i < METRIC_COUNT; ++i)
+        {
+            uint64_t buf[3];
+            values[i] = -1;
+            if (_fds[i] < 0 || ::read(_fds[i], buf, sizeof(buf)) != (ssize_t)sizeof(buf) || buf[2] == 0)
+                continue;
+            values[i] = (double)buf[0] * ((double)buf[1] / buf[2]) / calls;
+        }
+    }
+
+private:
+    int _fds[METRIC_COUNT];
+};
+
+using Results = std::map<std::string, double>; // "路径 计数器" -> 每次调用的值
+
+// 受CPU频率和负载影响的计数器，按与同一轮校准值的比例(名称加-rel)比较，原始值只用于显示
+static bool relative(size_t i)
+{
+    return g_metrics[i].config == PERF_COUNT_SW_TASK_CLOCK || (g_metrics[i].type == PERF_TYPE_HARDWARE && g_metrics[i].config == PERF_COUNT_HW_CPU_CYCLES);
+}
+
+static void keepMin(Results &results, const std::string &key, double value)
+{
+    auto it = results.find(key);
+    if (it == results.end())
+        results[key] = value;
+    else
+        it->second = std::min(it->second, value);
+}
+
+// 多轮测量取最小值，减少调度和其他进程带来的噪声；calibration为紧挨着本次测量的校准值
+static void record(Results &results, const std::string &path, double values[METRIC_COUNT], const double calibration[METRIC_COUNT])
+{
+    for (size_t i = 0; i < METRIC_COUNT; ++i)
+    {
+        if (values[i] < 0)
+            continue;
+        keepMin(results, path + " " + g_metrics[i].name, values[i]);
+        if (relative(i) && calibration && calibration[i] > 0)
+            keepMin(results, path + " " + g_metrics[i].name + "-rel", values[i] / calibration[i]);
+    }
+}
+
+static void print(const Results &results)
+{
+    for (const char *path : {"calibration", "sync.log", "async.push", "async.consume"})
+    {
+        for (size_t i = 0; i < METRIC_COUNT; ++i)
+        {
+            auto it = results.find(std::string(path) + " " + g_metrics[i].name);
+            std::cout << "\t" << path << "\t" << g_metrics[i].name << ":\t";
+            if (it != results.end())
+                std::cout << it->second << "\n";
+            else
+                std::cout << "n/a\n";
+            it = results.find(std::string(path) + " " + g_metrics[i].name + "-rel");
+            if (it != results.end())
+                std::cout << "\t" << path << "\t" << g_metrics[i].name << "-rel:\t" << it->second << "\n";
+        }
+    }
+}
+
+// 什么都不做的落地方向，只测量日志器本身；记录调用它的线程，用于找到异步线程
+// hold之后异步线程停在下一次写入中，直到release，测量生产者时不与异步线程争用锁
+class NullSink : public mylog::LogSink
+{
+public:
+    NullSink() : _tid(0), _hold(false), _held(false) {}
+    void log(const char *, const size_t &)
+    {
+        _tid = mylog::util::Thread::current().tid;
+        if (!_hold)
+            return;
+        std::unique_lock<std::mutex> lock(_mutex);
+        _held = _hold;
+        _cond.notify_all();
+        _cond.wait(lock, [&]()
+                   { return !_hold; });
+        _held = false;
+    }
+    pid_t tid() { return _tid; }
+    void hold()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _hold = true;
+    }
+    // 等待异步线程停在log中
+    void waitHeld()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cond.wait(lock, [&]()
+                   { return _held; });
+    }
+    void release()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _hold = false;
+        _cond.notify_all();
+    }
+
+private:
+    std::atomic<pid_t> _tid;
+    std::atomic<bool> _hold;
+    bool _held;
+    std::mutex _mutex;
+    std::condition_variable _cond;
+};
+
+static mylog::Logger::ptr build(const std::string &name, mylog::LoggerType type, const std::shared_ptr<NullSink> &sink, size_t buffer_size = 0)
+{
+    std::unique_ptr<mylog::LoggerBuilder> builder(new mylog::LocalLoggerBuilder());
+    builder->buildLoggername(name);
+    builder->buildLoggerType(type);
+    if (buffer_size)
+    {
+        builder->buildEnableUnsafeAsync();
+        builder->buildBufferSize(buffer_size);
+    }
+    builder->buildFormatter("[%d{%H:%M:%S.%3N}][%t][%c][%f:%l][%p]%T%m%n");
+    builder->buildSink(sink);
+    return builder->build();
+}
+
+// 与格式化相近的固定计算(格式化数字并拷贝)，在每次测量之前运行，用于换算CPU时间和周期数
+static void calibrate(size_t calls, Results &results, double values[METRIC_COUNT])
+{
+    char line[64], out[4096];
+    size_t pos = 0;
+    PerfCounters counters;
+    counters.start();
+    for (size_t i = 0; i < calls; ++i)
+    {
+        int len = snprintf(line, sizeof(line), "request %zu done in %d us\n", i, 42);
+        if (pos + len > sizeof(out))
+            pos = 0;
+        memcpy(out + pos, line, len);
+        pos += len;
+    }
+    counters.stop();
+    // 防止拷贝被优化掉
+    volatile char sink = out[pos / 2];
+    (void)sink;
+    counters.read(calls, values);
+    record(results, "calibration", values, nullptr);
+}
+
+static void syncBench(size_t calls, Results &results)
+{
+    auto sink = std::make_shared<NullSink>();
+    mylog::Logger::ptr logger = build("sync", mylog::LoggerType::LOGGER_SYNC, sink);
+    for (size_t i = 0; i < 1000; ++i)
+        logger->info("warm up %zu", i);
+    double calibration[METRIC_COUNT], values[METRIC_COUNT];
+    calibrate(calls, results, calibration);
+    PerfCounters counters;
+    counters.start();
+    for (size_t i = 0; i < calls; ++i)
+        logger->info("request %zu done in %d us", i, 42);
+    counters.stop();
+    counters.read(calls, values);
+    record(results, "sync.log", values, calibration);
+}
+
+static void asyncBench(size_t calls, Results &results)
+{
+    auto sink = std::make_shared<NullSink>();
+    // 缓冲区能容纳全部调用，测量期间不会扩容
+    mylog::Logger::ptr logger = build("async", mylog::LoggerType::LOGGER_ASYNC, sink, calls * 256);
+    for (size_t i = 0; i < 1000; ++i)
+        logger->info("warm up %zu", i);
+    logger->flush();
+    double calibration[METRIC_COUNT], values[METRIC_COUNT];
+    calibrate(calls, results, calibration);
+    PerfCounters producer, consumer(sink->tid());
+    // 异步线程停在落地方向中，生产者只写缓冲区
+    sink->hold();
+    logger->info("hold");
+    sink->waitHeld();
+    producer.start();
+    for (size_t i = 0; i < calls; ++i)
+        logger->info("request %zu done in %d us", i, 42);
+    producer.stop();
+    consumer.start();
+    sink->release();
+    logger->flush();
+    consumer.stop();
+    producer.read(calls, values);
+    record(results, "async.push", values, calibration);
+    consumer.read(calls, values);
+    record(results, "async.consume", values, calibration);
+}
+
+static bool loadBaseline(const std::string &pathname, Results &baseline)
+{
+    std::ifstream ifs(pathname);
+    if (!ifs.is_open())
+        return false;
+    std::string line;
+    while (std::getline(ifs, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream iss(line);
+        std::string path, metric;
+        double value;
+        if (iss >> path >> metric >> value)
+            baseline[path + " " + metric] = value;
+    }
+    return true;
+}
+
+static void saveBaseline(const std::string &pathname, const Results &results)
+{
+    std::ofstream ofs(pathname);
+    ofs << "# 路径 计数器 每次调用的值，由 ./perf -u 生成\n";
+    for (auto &it : results)
+        ofs << it.first << " " << it.second << "\n";
+}
+
+int main(int argc, char *argv[])
+{
+    std::string baseline_path = "perf_baseline.txt";
+    double tolerance = 0.2;
+    bool update = false;
+    int rounds = 5;
+    int opt;
+    while ((opt = getopt(argc, argv, "b:t:ur:")) != -1)
+    {
+        if (opt == 'b')
+            baseline_path = optarg;
+        else if (opt == 't')
+            tolerance = atof(optarg);
+        else if (opt == 'u')
+            update = true;
+        else if (opt == 'r')
+            rounds = std::max(1, atoi(optarg));
+        else
+        {
+            std::cout << "用法: " << argv[0] << " [-b 基准文件] [-t 容差] [-r 轮数] [-u]\n";
+            return 2;
+        }
+    }
+    const size_t calls = 200000;
+    Results results;
+    for (int r = 0; r < rounds; ++r)
+    {
+        syncBench(calls, results);
+        asyncBench(calls, results);
+    }
+    print(results);
+    if (update)
+    {
+        saveBaseline(baseline_path, results);
+        std::cout << "基准已写入: " << baseline_path << "\n";
+        return 0;
+    }
+    Results baseline;
+    if (!loadBaseline(baseline_path, baseline))
+    {
+        std::cout << "基准文件不存在: " << baseline_path << "，使用 -u 生成\n";
+        return 2;
+    }
+    // 只比较两边都有的计数器，CPU时间和周期数只比较-rel；值很小的计数器(例如上下文切换)另外允许0.01的绝对误差
+    int regressions = 0;
+    for (auto &it : results)
+    {
+        auto base = baseline.find(it.first);
+        if (base == baseline.end() || it.first.compare(0, 12, "calibration ") == 0)
+            continue;
+        std::string metric = it.first.substr(it.first.find(' ') + 1);
+        if (metric == "task-clock-ns" || metric == "cycles")
+            continue;
+        if (it.second > base->second * (1 + tolerance) + 0.01)
+        {
+            std::cout << "性能退化: " << it.first << " " << base->second << " -> " << it.second << "\n";
+            ++regressions;
+        }
+    }
+    std::cout << (regressions ? "存在性能退化\n" : "与基准相比没有退化\n");
+    return regressions ? 1 : 0;
+}
@@ -0,0 +1,158 @@
+#include "../mylog/mylog.h"
+#include <atomic>
+#include <cstddef>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+
+/*
+    校验实时日志器写日志的路径：在子进程中创建实时日志器，写日志的线程只对自己安装seccomp过滤器，
+    除退出相关的调用外任何系统调用都会触发SIGSYS并被计数；同时替换malloc系列函数统计该线程的内存分配
+    任何计数不为0时返回非0
+*/
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t n, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void __libc_free(void *ptr);
+
+struct Counters
+{
+    std::atomic<size_t> allocs;
+    std::atomic<size_t> syscalls;
+    std::atomic<size_t> logged;
+    std::atomic<size_t> full;
+    std::atomic<bool> done;
+};
+static Counters *g_counters = nullptr;       // 父子进程共享，子进程异常退出时父进程也能看到结果
+static thread_local bool t_measuring = false; // 只统计写日志的线程
+
+extern "C" void *malloc(size_t size)
+{
+    if (t_measuring)
+        g_counters->allocs.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+extern "C" void *calloc(size_t n, size_t size)
+{
+    if (t_measuring)
+        g_counters->allocs.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(n, size);
+}
+extern "C" void *realloc(void *ptr, size_t size)
+{
+    if (t_measuring)
+        g_counters->allocs.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+extern "C" void free(void *ptr)
+{
+    __libc_free(ptr);
+}
+
+static void onSigsys(int, siginfo_t *, void *)
+{
+    g_counters->syscalls.fetch_add(1, std::memory_order_relaxed);
+}
+
+// 只作用于当前线程的过滤器：允许退出和从信号处理函数返回，其余系统调用一律触发SIGSYS
+static bool denySyscalls()
+{
+    struct sock_filter filter[] = {
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, nr)),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_rt_sigreturn, 3, 0),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_exit, 2, 0),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_exit_group, 1, 0),
+        BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_TRAP),
+        BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW),
+    };
+    struct sock_fprog prog = {(unsigned short)(sizeof(filter) / sizeof(filter[0])), filter};
+    if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) != 0)
+        return false;
+    return prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &prog) == 0;
+}
+
+// 只计数的落地方向，确认写入的日志全部由后台线程处理
+class CountSink : public mylog::LogSink
+{
+public:
+    void log(const char *data, const size_t &len)
+    {
+        for (size_t i = 0; i < len; ++i)
+        {
+            if (data[i] == '\n')
+                g_counters->logged.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+};
+
+static void child(size_t msg_count)
+{
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = onSigsys;
+    sa.sa_flags = SA_SIGINFO;
+    sigaction(SIGSYS, &sa, nullptr);
+
+    std::unique_ptr<mylog::LoggerBuilder> builder(new mylog::LocalLoggerBuilder());
+    builder->buildLoggername("realtime");
+    builder->buildLoggerType(mylog::LoggerType::LOGGER_REALTIME);
+    builder->buildRealtimeSlots(msg_count * 2, 128);
+    builder->buildFormatter("[%d{%H:%M:%S}][%t][%p][%X]%T%m%n");
+    builder->buildSink<CountSink>();
+    mylog::Logger::ptr logger = builder->build();
+
+    std::thread producer([&]()
+                         {
+        // 诊断上下文在设置时渲染，写日志时只拷贝到槽中
+        mylog::MDC::Scope req("req", "42"), user("user", "bench");
+        // 预热：线程标识、TSC时钟以及vsnprintf的首次调用都可能进行系统调用或申请内存
+        for (int i = 0; i < 16; ++i)
+            logger->info("warm up %d", i);
+        if (!denySyscalls())
+        {
+            std::cout << "seccomp过滤器安装失败\n";
+            _exit(2);
+        }
+        t_measuring = true;
+        for (size_t i = 0; i < msg_count; ++i)
+        {
+            if (logger->tryLog(mylog::LogLevel::value::INFO, __FILE__, __LINE__, "message %zu value %f", i, i * 0.5) == mylog::LogStatus::FULL)
+                g_counters->full.fetch_add(1, std::memory_order_relaxed);
+            logger->warn("message %zu", i);
+        }
+        t_measuring = false;
+        g_counters->done = true;
+        // 过滤器下无法正常退出线程(会释放栈等)，等待进程退出
+        while (g_counters->done.load())
+            ; });
+    while (!g_counters->done)
+        usleep(1000);
+    logger->flush();
+    _exit(0);
+}
+
+int main()
+{
+    const size_t msg_count = 100000;
+    g_counters = static_cast<Counters *>(mmap(nullptr, sizeof(Counters), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+    assert(g_counters != MAP_FAILED);
+    new (g_counters) Counters();
+    pid_t pid = fork();
+    if (pid == 0)
+        child(msg_count);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    std::cout << "写日志线程 系统调用:" << g_counters->syscalls << " 内存分配:" << g_counters->allocs
+              << " 槽满丢弃:" << g_counters->full << " 后台输出:" << g_counters->logged << "/" << msg_count * 2 + 16 << "\n";
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        std::cout << "子进程异常退出\n";
+        return 1;
+    }
+    return g_counters->syscalls || g_counters->allocs ? 1 : 0;
+}
@@ -0,0 +1,163 @@
+#include "../mylog/shm.hpp"
+#include <map>
+#include <set>
+#include <sys/wait.h>
+#include <vector>
+
+/*
+    共享内存环形队列的多进程检查(make shm_check)：
+        多个子进程同时写入，其中一个在预留空间后、提交前崩溃(拷贝的数据源不可读，memcpy时触发SIGSEGV)
+        崩溃的进程之后仍有进程写入，收集器在仍有存活的生产者时不能恢复，全部退出后recover使队列恢复
+        每条成功写入的记录恰好收到一次，同一进程的记录保持写入顺序，失败的写入都计入dropped()
+    任何一项失败时返回非0
+*/
+
+static size_t g_failed = 0;
+
+static void expect(bool ok, const std::string &what)
+{
+    std::cout << (ok ? "通过: " : "失败: ") << what << std::endl;
+    g_failed += !ok;
+}
+
+static const int WRITERS = 4;
+static const int RECORDS = 20000;
+
+// 子进程写入"编号 序号"，写完后把成功的条数写入管道；crash为true时写完一半后崩溃在一次预留中
+static void writer(const std::string &name, int id, bool crash, int fd)
+{
+    mylog::ShmRing ring(name);
+    ring.attachProducer();
+    int count = crash ? RECORDS / 2 : RECORDS;
+    uint64_t ok = 0;
+    char line[32];
+    for (int seq = 0; seq < count; ++seq)
+    {
+        int len = snprintf(line, sizeof(line), "%d %d", id, seq);
+        ok += ring.push(line, len);
+    }
+    uint64_t report[2] = {(uint64_t)id, ok};
+    if (write(fd, report, sizeof(report)) != sizeof(report))
+        _exit(2);
+    if (crash)
+    {
+        // 等收集器取空队列，保证这次预留能成功
+        usleep(100 * 1000);
+        char *bad = static_cast<char *>(mmap(nullptr, 4096, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        ring.push(bad, 64);
+    }
+    // 不注销登记，与崩溃的进程一样由收集器通过pid判断
+    _exit(0);
+}
+
+int main()
+{
+    std::string name = "shm-check-" + std::to_string(getpid());
+    mylog::ShmRing::unlink(name);
+    // 容量远小于写入总量，写入方会遇到队列已满
+    mylog::ShmRing ring(name, 64 * 1024);
+    expect(ring.valid(), "创建共享内存队列");
+    if (!ring.valid())
+        return 1;
+
+    int fds[2];
+    if (pipe(fds) != 0)
+        return 1;
+    std::vector<pid_t> pids;
+    std::map<int, std::vector<int>> received;
+    auto collect = [&]()
+    {
+        return ring.drain([&](const char *data, size_t len)
+                          {
+                              std::string line(data, len);
+                              int id = -1, seq = -1;
+                              sscanf(line.c_str(), "%d %d", &id, &seq);
+                              received[id].push_back(seq); });
+    };
+    // 0号先写一半后崩溃，留下未提交的预留；其余进程随后开始写入，数据排在未提交的记录之后
+    pid_t crasher = fork();
+    if (crasher == 0)
+        writer(name, 0, true, fds[1]);
+    int status = 0;
+    while (waitpid(crasher, &status, WNOHANG) == 0)
+    {
+        collect();
+        usleep(100);
+    }
+    expect(WIFSIGNALED(status) && WTERMSIG(status) == SIGSEGV, "0号写入方在预留后崩溃");
+    for (int id = 1; id < WRITERS; ++id)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+            writer(name, id, false, fds[1]);
+        pids.push_back(pid);
+    }
+    // 另有一个存活的生产者，此时队列不能恢复
+    int hold[2];
+    if (pipe(hold) != 0)
+        return 1;
+    pid_t holder = fork();
+    if (holder == 0)
+    {
+        mylog::ShmRing held(name);
+        held.attachProducer();
+        char c;
+        if (read(hold[0], &c, 1) < 0)
+            _exit(2);
+        _exit(0);
+    }
+    close(fds[1]);
+
+    for (pid_t pid : pids)
+    {
+        // 崩溃留下的记录挡住了后面的数据，此时只能等待
+        while (waitpid(pid, &status, WNOHANG) == 0)
+        {
+            collect();
+            usleep(100);
+        }
+    }
+    collect();
+    expect(!ring.recover(), "仍有存活的生产者时不恢复");
+
+    if (write(hold[1], "x", 1) != 1)
+        return 1;
+    waitpid(holder, &status, 0);
+    // 所有生产者退出后，恢复只跳过崩溃的那一条预留
+    bool recovered = ring.recover();
+    expect(recovered, "生产者都退出后恢复队列");
+    collect();
+    expect(!ring.recover() && collect() == 0, "恢复后队列为空");
+
+    std::map<int, uint64_t> pushed;
+    uint64_t report[2];
+    while (read(fds[0], report, sizeof(report)) == sizeof(report))
+        pushed[(int)report[0]] = report[1];
+
+    bool exactly_once = true, ordered = true;
+    uint64_t total_pushed = 0, total_attempts = RECORDS / 2 + (WRITERS - 1) * RECORDS + 1;
+    for (int id = 0; id < WRITERS; ++id)
+    {
+        const std::vector<int> &seqs = received[id];
+        std::set<int> unique(seqs.begin(), seqs.end());
+        exactly_once = exactly_once && unique.size() == seqs.size() && seqs.size() == pushed[id];
+        for (size_t i = 1; i < seqs.size(); ++i)
+            ordered = ordered && seqs[i - 1] < seqs[i];
+        total_pushed += pushed[id];
+    }
+    expect(received.size() == WRITERS, "收到的记录都来自写入方");
+    expect(exactly_once, "成功写入的记录恰好收到一次");
+    expect(ordered, "同一进程的记录保持写入顺序");
+    // 崩溃的那次写入预留成功，既不在收到的记录中，也不计入dropped
+    expect(ring.dropped() == total_attempts - 1 - total_pushed, "失败的写入都计入dropped");
+    expect(ring.dropped() > 0, "写入方遇到过队列已满");
+
+    // 恢复后的队列可以继续写入
+    ring.attachProducer();
+    expect(ring.push("after", 5) && collect() == 5, "恢复后可以继续写入");
+    ring.detachProducer();
+
+    mylog::ShmRing::unlink(name);
+    std::cout << (g_failed ? "存在失败的检查\n" : "全部通过\n");
+    return g_failed ? 1 : 0;
+}
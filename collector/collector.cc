@@ -0,0 +1,85 @@
+#include "../mylog/mylog.h"
+#include "../mylog/shm.hpp"
+#include <signal.h>
+#include <vector>
+
+// 日志收集进程：轮询各进程的共享内存环形队列，并写入各自的滚动文件
+// 用法: ./collector <日志目录> <单个文件最大字节数> <队列名> [队列名...]
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void onSignal(int)
+{
+    g_stop = 1;
+}
+
+struct Channel
+{
+    mylog::ShmRing::ptr ring;
+    mylog::LogSink::ptr sink;
+    size_t dropped;
+};
+
+// 把一个队列中已提交的记录汇总到缓冲区后一次性写入文件，返回本轮处理的字节数
+static size_t drainChannel(Channel &ch, mylog::Buffer &buf)
+{
+    size_t bytes = ch.ring->drain([&](const char *data, size_t len)
+                                  { buf.push(data, len); });
+    if (bytes == 0)
+    {
+        if (ch.ring->recover())
+            std::cerr << ch.ring->name() << ": 生产者已退出，丢弃未提交的记录\n";
+        return 0;
+    }
+    ch.sink->log(buf.begin(), buf.readAbleSize());
+    buf.reset();
+    size_t dropped = ch.ring->dropped();
+    if (dropped != ch.dropped)
+    {
+        std::cerr << ch.ring->name() << ": 队列已满，累计丢弃" << dropped << "条\n";
+        ch.dropped = dropped;
+    }
+    return bytes;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 4)
+    {
+        std::cerr << "用法: " << argv[0] << " <日志目录> <单个文件最大字节数> <队列名> [队列名...]\n";
+        return 1;
+    }
+    std::string dir = argv[1];
+    if (dir.back() != '/')
+        dir.push_back('/');
+    size_t max_fsize = std::stoul(argv[2]);
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    std::vector<Channel> channels;
+    for (int i = 3; i < argc; ++i)
+    {
+        Channel ch;
+        ch.ring = std::make_shared<mylog::ShmRing>(argv[i]);
+        if (!ch.ring->valid())
+            continue;
+        ch.sink = mylog::SinkFactory::create<mylog::RollBySizeSink>(dir + argv[i] + "-", max_fsize);
+        ch.dropped = ch.ring->dropped();
+        channels.push_back(ch);
+    }
+
+    mylog::Buffer buf;
+    while (!g_stop)
+    {
+        size_t bytes = 0;
+        for (auto &ch : channels)
+            bytes += drainChannel(ch, buf);
+        if (bytes == 0)
+            usleep(1000);
+    }
+    // 退出前把剩余数据全部落地
+    for (auto &ch : channels)
+        drainChannel(ch, buf);
+    return 0;
+}
@@ -0,0 +1,146 @@
+#ifndef __MY_ALLOC__
+#define __MY_ALLOC__
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdlib>
+#include <sys/mman.h>
+
+namespace mylog
+{
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#define DEFAULT_POOL_BLOCKS 8
+
+    /*
+        缓冲区内存的分配器，分配的内存不做初始化
+        allocate时size为需要的最小字节数，分配器可以将其调大(例如按大页取整)，调用者按调整后的大小使用，
+        deallocate时传回同样的size
+    */
+    class Allocator
+    {
+    public:
+        using ptr = std::shared_ptr<Allocator>;
+        virtual ~Allocator() {}
+        virtual char *allocate(size_t &size) = 0;
+        virtual void deallocate(char *data, size_t size) = 0;
+        // 新建的缓冲区默认使用的分配器
+        static ptr getDefault()
+        {
+            return std::atomic_load(&defaultRef());
+        }
+        static void setDefault(const ptr &alloc)
+        {
+            std::atomic_store(&defaultRef(), alloc);
+        }
+
+    private:
+        static ptr &defaultRef();
+    };
+
+    // malloc/free，与std::vector相比省去了清零
+    class MallocAllocator : public Allocator
+    {
+    public:
+        char *allocate(size_t &size)
+        {
+            return static_cast<char *>(malloc(size));
+        }
+        void deallocate(char *data, size_t)
+        {
+            free(data);
+        }
+    };
+
+    inline Allocator::ptr &Allocator::defaultRef()
+    {
+        static ptr alloc = std::make_shared<MallocAllocator>();
+        return alloc;
+    }
+
+    // 大页内存：优先使用预留的大页(MAP_HUGETLB)，没有预留时退回普通页并建议内核使用透明大页
+    class HugePageAllocator : public Allocator
+    {
+    public:
+        char *allocate(size_t &size)
+        {
+            size = (size + HUGE_PAGE_SIZE - 1) & ~(size_t)(HUGE_PAGE_SIZE - 1);
+            void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (addr == MAP_FAILED)
+            {
+                addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (addr == MAP_FAILED)
+                    return nullptr;
+                madvise(addr, size, MADV_HUGEPAGE);
+            }
+            return static_cast<char *>(addr);
+        }
+        void deallocate(char *data, size_t size)
+        {
+            munmap(data, size);
+        }
+    };
+
+    /*
+        固定大小内存块的回收池：不超过block_size的申请都分配一整块，释放后留在池中供下次使用，
+        池中最多保留max_blocks块；更大的申请直接交给上游分配器
+        频繁创建、销毁缓冲区(例如日志器的增删)时避免反复向系统申请大块内存
+        block_size应为上游分配器分配粒度的整数倍(例如大页分配器为2MB)
+    */
+    class BlockPool : public Allocator
+    {
+    public:
+        BlockPool(size_t block_size, size_t max_blocks = DEFAULT_POOL_BLOCKS, const Allocator::ptr &upstream = std::make_shared<MallocAllocator>())
+            : _block_size(block_size), _max_blocks(max_blocks), _upstream(upstream)
+        {
+        }
+        ~BlockPool()
+        {
+            for (char *block : _free)
+                _upstream->deallocate(block, _block_size);
+        }
+        char *allocate(size_t &size)
+        {
+            if (size > _block_size)
+                return _upstream->allocate(size);
+            size = _block_size;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                if (!_free.empty())
+                {
+                    char *block = _free.back();
+                    _free.pop_back();
+                    return block;
+                }
+            }
+            size_t block_size = _block_size;
+            return _upstream->allocate(block_size);
+        }
+        void deallocate(char *data, size_t size)
+        {
+            if (size == _block_size)
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                if (_free.size() < _max_blocks)
+                {
+                    _free.push_back(data);
+                    return;
+                }
+            }
+            _upstream->deallocate(data, size);
+        }
+        size_t cached()
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            return _free.size();
+        }
+
+    private:
+        size_t _block_size;
+        size_t _max_blocks;
+        Allocator::ptr _upstream;
+        std::mutex _mutex;
+        std::vector<char *> _free;
+    };
+}
+
+#endif
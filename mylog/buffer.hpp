@@ -1,53 +1,133 @@
 #ifndef __MY_BUFFER__
 #define __MY_BUFFER__
 #include "util.hpp"
+#include "message.hpp"
+#include "alloc.hpp"
 #include <vector>
 #include <cassert>
+#include <cstring>
+#include <sys/uio.h>
 
 namespace mylog
 {
 #define DEFAULT_BUFFER_SIZE (10 * 1024 * 1024)
 #define THRESHOLD_BUFFER_SIZE (80 * 1024 * 1024)
 #define INCREMENT_BUFFER_SIZE (10 * 1024 * 1024)
+#define PAGE_SIZE_HINT 4096
+    // 内存由分配器提供且不做初始化，需要预先分配物理页时调用prefault
     class Buffer
     {
     public:
-        Buffer() : _buffer(DEFAULT_BUFFER_SIZE), _writer_idx(0), _reader_idx(0)
+        Buffer(size_t size = DEFAULT_BUFFER_SIZE, const Allocator::ptr &alloc = Allocator::getDefault())
+            : _alloc(alloc), _data(nullptr), _capacity(size), _reader_idx(0), _writer_idx(0)
         {
+            if (_capacity)
+            {
+                _data = _alloc->allocate(_capacity);
+                assert(_data != nullptr);
+            }
+        }
+        ~Buffer()
+        {
+            if (_data)
+                _alloc->deallocate(_data, _capacity);
         }
+        Buffer(const Buffer &) = delete;
+        Buffer &operator=(const Buffer &) = delete;
         void push(const char *data, const size_t len)
         {
             // 先确保满足空间大小
             ensureEnoughSize(len);
-            std::copy(data, data + len, &_buffer[_writer_idx]);
+            memcpy(_data + _writer_idx, data, len);
             moveWriter(len);
         }
+        // 分段写入，各段依次拷贝到缓冲区中，保证一条日志在缓冲区中是连续的
+        void push(const struct iovec *iov, int iovcnt)
+        {
+            size_t len = 0;
+            for (int i = 0; i < iovcnt; ++i)
+                len += iov[i].iov_len;
+            ensureEnoughSize(len);
+            for (int i = 0; i < iovcnt; ++i)
+            {
+                memcpy(_data + _writer_idx, iov[i].iov_base, iov[i].iov_len);
+                moveWriter(iov[i].iov_len);
+            }
+        }
+        // 写入一条日志并记录其元信息
+        void push(const struct iovec *iov, int iovcnt, const LogRecord &record)
+        {
+            push(iov, iovcnt);
+            _records.push_back(record);
+        }
+        void push(char ch)
+        {
+            ensureEnoughSize(1);
+            _data[_writer_idx] = ch;
+            moveWriter(1);
+        }
         // 返回可读数据的开头
         const char *begin()
         {
-            return &_buffer[_reader_idx];
+            return _data + _reader_idx;
         }
         size_t readAbleSize()
         {
             return (_writer_idx - _reader_idx);
         }
+        // 分配器给出的实际容量，可能大于请求的大小
+        size_t capacity()
+        {
+            return _capacity;
+        }
         size_t writeAbleSize()
         {
-            return (_buffer.size() - _writer_idx);
+            return (_capacity - _writer_idx);
         }
         void moveReader(const size_t len)
         {
             assert(len <= readAbleSize());
             _reader_idx += len;
         }
+        const LogRecord *records()
+        {
+            return _records.data();
+        }
+        size_t recordCount()
+        {
+            return _records.size();
+        }
+        // 每页写一个字节，让当前线程立即分配物理页(首次访问原则下页面位于当前线程所在的NUMA节点)
+        void prefault()
+        {
+            for (size_t off = 0; off < _capacity; off += PAGE_SIZE_HINT)
+                *static_cast<volatile char *>(_data + off) = 0;
+        }
         void reset()
         {
             _reader_idx = 0;
             _writer_idx = 0;
+            _records.clear();
+        }
+        // 容量超过size时重新分配为size并返回true，只能在缓冲区为空时调用
+        bool shrink(size_t size)
+        {
+            assert(empty());
+            if (_capacity <= size)
+                return false;
+            char *data = _alloc->allocate(size);
+            assert(data != nullptr);
+            _alloc->deallocate(_data, _capacity);
+            _data = data;
+            _capacity = size;
+            return true;
         }
         void swap(Buffer &buffer)
         {
-            _buffer.swap(buffer._buffer);
+            _alloc.swap(buffer._alloc);
+            std::swap(_data, buffer._data);
+            std::swap(_capacity, buffer._capacity);
+            _records.swap(buffer._records);
             std::swap(_writer_idx, buffer._writer_idx);
             std::swap(_reader_idx, buffer._reader_idx);
         }
@@ -59,27 +139,39 @@ namespace mylog
     private:
         void moveWriter(const size_t len)
         {
-            assert(len + _writer_idx <= _buffer.size());
+            assert(len + _writer_idx <= _capacity);
             _writer_idx += len;
         }
         void ensureEnoughSize(size_t len)
         {
-            if (len < writeAbleSize())
+            if (len <= writeAbleSize())
                 return;
             size_t new_size = 0;
-            if (_buffer.size() < THRESHOLD_BUFFER_SIZE)
+            if (_capacity < THRESHOLD_BUFFER_SIZE)
             {
-                new_size = _buffer.size() * 2 + len;
+                new_size = _capacity * 2 + len;
             }
             else
             {
-                new_size = _buffer.size() + INCREMENT_BUFFER_SIZE + len;
+                new_size = _capacity + INCREMENT_BUFFER_SIZE + len;
+            }
+            // 只需要拷贝已写入的部分
+            char *data = _alloc->allocate(new_size);
+            assert(data != nullptr);
+            if (_data)
+            {
+                memcpy(data, _data, _writer_idx);
+                _alloc->deallocate(_data, _capacity);
             }
-            _buffer.resize(new_size);
+            _data = data;
+            _capacity = new_size;
         }
 
     private:
-        std::vector<char> _buffer;
+        Allocator::ptr _alloc;
+        char *_data;
+        size_t _capacity;
+        std::vector<LogRecord> _records; // 通过带元信息的push写入的各条日志
         size_t _reader_idx;
         size_t _writer_idx;
     };
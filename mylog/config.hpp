@@ -0,0 +1,372 @@
+#ifndef __MY_CONFIG__
+#define __MY_CONFIG__
+#include "logger.hpp"
+#include "shm.hpp"
+#include "dgram.hpp"
+#include "console.hpp"
+#include <fstream>
+#include <poll.h>
+#include <sys/inotify.h>
+
+namespace mylog
+{
+    /*
+        通过配置文件(INI格式)声明日志器，例如：
+            # 以'#'或';'开头的整行为注释，type为sync、async或realtime
+            [logger.net]
+            type = async
+            level = INFO
+            flush_level = ERROR
+            pattern = [%d{%H:%M:%S}][%-5p]%m%n
+            sinks = stdout, file:./logs/net.log, roll:./logs/net-:1048576@ERROR
+            async_unsafe = false
+            buffer_size = 1048576
+            cpus = 2,3
+            sched = other
+            nice = 10
+            thread_name = net-log
+            looper_pool = 2
+            max_message_size = 65536
+            spill_file = ./logs/net.spill
+        max_message_size为消息主体的最大字节数(0表示不限制)，超长消息截断，配置了spill_file时完整内容写入该文件
+        type为realtime时可以用realtime_slots、realtime_slot_size设置槽数和每个槽的字节数
+        looper_pool为非0时使用进程内共享的异步线程池(值为线程数，以第一个使用者为准)，此时忽略缓冲区和线程参数
+        cpus、sched(other、fifo:优先级、rr:优先级)、nice、thread_name设置异步线程，运行中修改需要重启
+        sinks支持: stdout、console(WARN及以上写标准错误，终端下带颜色)、file:路径、roll:基础文件名:最大字节数、shm:队列名、dgram:地址，
+        后面加"@等级"表示该落地方向只输出不低于此等级的日志
+        [logger.root]可以调整默认日志器的等级和格式
+        日志器名称以'.'表示层级(例如[logger.net.http])，没有配置的level、pattern、sinks继承自最近的上级日志器
+    */
+    struct LoggerConfig
+    {
+        std::string name;
+        LoggerType type = LoggerType::LOGGER_SYNC;
+        LogLevel::value level = LogLevel::value::UNKOWN; // 未配置
+        LogLevel::value flush_level = LogLevel::value::UNKOWN;
+        std::string pattern;
+        std::vector<std::string> sinks;
+        bool async_unsafe = false;
+        size_t buffer_size = DEFAULT_BUFFER_SIZE;
+        LooperOptions looper;
+        size_t looper_pool = 0; // 0表示使用独立的异步线程
+        size_t realtime_slots = DEFAULT_RT_SLOT_COUNT;
+        size_t realtime_slot_size = DEFAULT_RT_SLOT_SIZE;
+        long long max_message_size = -1; // 小于0表示未配置
+        std::string spill_file;
+    };
+
+    class Config
+    {
+    public:
+        // 解析配置文件，格式错误的行输出提示后跳过
+        static bool parse(const std::string &pathname, std::vector<LoggerConfig> &configs)
+        {
+            std::ifstream ifs(pathname);
+            if (!ifs.is_open())
+            {
+                std::cout << "配置文件打开失败: " << pathname << std::endl;
+                return false;
+            }
+            std::string line;
+            LoggerConfig *cur = nullptr;
+            for (size_t lineno = 1; std::getline(ifs, line); ++lineno)
+            {
+                line = trim(line);
+                if (line.empty() || line[0] == '#' || line[0] == ';')
+                    continue;
+                if (line[0] == '[')
+                {
+                    const std::string prefix = "[logger.";
+                    if (line.back() != ']' || line.compare(0, prefix.size(), prefix) != 0)
+                    {
+                        std::cout << pathname << ":" << lineno << " 无法识别的配置段" << std::endl;
+                        cur = nullptr;
+                        continue;
+                    }
+                    configs.push_back(LoggerConfig());
+                    cur = &configs.back();
+                    cur->name = line.substr(prefix.size(), line.size() - prefix.size() - 1);
+                    continue;
+                }
+                size_t pos = line.find('=');
+                if (cur == nullptr || pos == std::string::npos || !setField(*cur, trim(line.substr(0, pos)), trim(line.substr(pos + 1))))
+                    std::cout << pathname << ":" << lineno << " 配置项格式错误" << std::endl;
+            }
+            return true;
+        }
+        // 按配置创建日志器；已经存在的日志器只更新等级和格式(落地方向、同步异步等需要重启才能修改)
+        static bool load(const std::string &pathname)
+        {
+            std::vector<LoggerConfig> configs;
+            if (!parse(pathname, configs))
+                return false;
+            for (auto &conf : configs)
+            {
+                Logger::ptr logger = LoggerManager::getInstance().getLogger(conf.name);
+                if (logger)
+                {
+                    apply(logger, conf);
+                    continue;
+                }
+                std::unique_ptr<LoggerBuilder> builder(new GlobalLoggerBuilder());
+                builder->buildLoggername(conf.name);
+                builder->buildLoggerType(conf.type);
+                if (conf.level != LogLevel::value::UNKOWN)
+                    builder->buildLoggerLevel(conf.level);
+                if (conf.flush_level != LogLevel::value::UNKOWN)
+                    builder->buildFlushLevel(conf.flush_level);
+                builder->buildBufferSize(conf.buffer_size);
+                if (conf.async_unsafe)
+                    builder->buildEnableUnsafeAsync();
+                builder->buildLooperAffinity(conf.looper.cpus);
+                builder->buildLooperPriority(conf.looper.policy, conf.looper.priority);
+                builder->buildLooperNice(conf.looper.nice);
+                if (conf.looper.name.size())
+                    builder->buildLooperName(conf.looper.name);
+                builder->buildRealtimeSlots(conf.realtime_slots, conf.realtime_slot_size);
+                if (conf.max_message_size >= 0)
+                    builder->buildMaxMessageSize(conf.max_message_size, conf.spill_file);
+                if (conf.looper_pool)
+                    builder->buildLooperPool(LooperPool::global(conf.looper_pool));
+                if (conf.pattern.size())
+                    builder->buildFormatter(conf.pattern);
+                for (auto &spec : conf.sinks)
+                {
+                    LogSink::ptr sink = createSink(spec);
+                    if (sink)
+                        builder->buildSink(sink);
+                }
+                builder->build();
+            }
+            return true;
+        }
+        // 对运行中的日志器原子地应用等级、刷新等级、格式和消息的最大长度，不停止异步线程，已缓冲的数据不受影响(溢出文件需要重启才能修改)
+        static void apply(const Logger::ptr &logger, const LoggerConfig &conf)
+        {
+            if (conf.level != LogLevel::value::UNKOWN)
+                logger->setLevel(conf.level);
+            if (conf.flush_level != LogLevel::value::UNKOWN)
+                logger->setFlushLevel(conf.flush_level);
+            // 格式没有变化时不替换，替换下来的格式化方案要到日志器销毁时才释放
+            if (conf.pattern.size() && conf.pattern != logger->getFormatter()->pattern())
+                logger->setFormatter(std::make_shared<Formatter>(conf.pattern));
+            if (conf.max_message_size >= 0)
+                logger->setMaxMessageSize(conf.max_message_size);
+        }
+
+    private:
+        static bool setField(LoggerConfig &conf, const std::string &key, const std::string &val)
+        {
+            if (key == "type")
+            {
+                if (val == "sync")
+                    conf.type = LoggerType::LOGGER_SYNC;
+                else if (val == "async")
+                    conf.type = LoggerType::LOGGER_ASYNC;
+                else if (val == "realtime")
+                    conf.type = LoggerType::LOGGER_REALTIME;
+                else
+                    return false;
+            }
+            else if (key == "level")
+            {
+                conf.level = LogLevel::fromString(val);
+                if (conf.level == LogLevel::value::UNKOWN)
+                    return false;
+            }
+            else if (key == "flush_level")
+            {
+                conf.flush_level = LogLevel::fromString(val);
+                if (conf.flush_level == LogLevel::value::UNKOWN)
+                    return false;
+            }
+            else if (key == "pattern")
+            {
+                std::string error;
+                if (!Formatter::check(val, &error))
+                {
+                    std::cout << "日志格式有误(" << error << ")" << std::endl;
+                    return false;
+                }
+                conf.pattern = val;
+            }
+            else if (key == "sinks")
+            {
+                conf.sinks.clear();
+                size_t pos = 0;
+                while (pos <= val.size())
+                {
+                    size_t end = val.find(',', pos);
+                    if (end == std::string::npos)
+                        end = val.size();
+                    std::string spec = trim(val.substr(pos, end - pos));
+                    if (spec.size())
+                        conf.sinks.push_back(spec);
+                    pos = end + 1;
+                }
+            }
+            else if (key == "cpus")
+            {
+                conf.looper.cpus.clear();
+                for (const char *ptr = val.c_str(); *ptr;)
+                {
+                    char *end;
+                    long cpu = strtol(ptr, &end, 10);
+                    if (end == ptr)
+                        return false;
+                    conf.looper.cpus.push_back(cpu);
+                    ptr = end;
+                    while (*ptr == ',' || *ptr == ' ')
+                        ++ptr;
+                }
+            }
+            else if (key == "sched")
+            {
+                size_t pos = val.find(':');
+                std::string policy = val.substr(0, pos);
+                conf.looper.priority = pos == std::string::npos ? 0 : atoi(val.c_str() + pos + 1);
+                if (policy == "other")
+                    conf.looper.policy = SCHED_OTHER;
+                else if (policy == "fifo")
+                    conf.looper.policy = SCHED_FIFO;
+                else if (policy == "rr")
+                    conf.looper.policy = SCHED_RR;
+                else
+                    return false;
+            }
+            else if (key == "nice")
+                conf.looper.nice = atoi(val.c_str());
+            else if (key == "thread_name")
+                conf.looper.name = val;
+            else if (key == "looper_pool")
+                conf.looper_pool = strtoul(val.c_str(), nullptr, 10);
+            else if (key == "realtime_slots")
+                conf.realtime_slots = strtoul(val.c_str(), nullptr, 10);
+            else if (key == "realtime_slot_size")
+                conf.realtime_slot_size = strtoul(val.c_str(), nullptr, 10);
+            else if (key == "max_message_size")
+            {
+                char *end;
+                long long size = strtoll(val.c_str(), &end, 10);
+                if (end == val.c_str() || *end || size < 0)
+                    return false;
+                conf.max_message_size = size;
+            }
+            else if (key == "spill_file")
+                conf.spill_file = val;
+            else if (key == "async_unsafe")
+                conf.async_unsafe = (val == "true" || val == "1" || val == "yes");
+            else if (key == "buffer_size")
+                conf.buffer_size = strtoul(val.c_str(), nullptr, 10);
+            else
+                return false;
+            return true;
+        }
+        static LogSink::ptr createSink(const std::string &spec)
+        {
+            size_t at = spec.find_last_of('@');
+            if (at != std::string::npos)
+            {
+                LogLevel::value level = LogLevel::fromString(spec.substr(at + 1));
+                LogSink::ptr sink = level == LogLevel::value::UNKOWN ? LogSink::ptr() : createSink(spec.substr(0, at));
+                if (sink)
+                    sink->setLevel(level);
+                else
+                    std::cout << "无法识别的落地方向: " << spec << std::endl;
+                return sink;
+            }
+            size_t pos = spec.find(':');
+            std::string type = spec.substr(0, pos);
+            std::string arg = pos == std::string::npos ? "" : spec.substr(pos + 1);
+            if (type == "stdout")
+                return SinkFactory::create<StdoutSink>();
+            if (type == "console")
+                return SinkFactory::create<ConsoleSink>();
+            if (type == "file" && arg.size())
+                return SinkFactory::create<FileSink>(arg);
+            if (type == "roll")
+            {
+                size_t sep = arg.find_last_of(':');
+                if (sep != std::string::npos)
+                    return SinkFactory::create<RollBySizeSink>(arg.substr(0, sep), (size_t)strtoul(arg.c_str() + sep + 1, nullptr, 10));
+            }
+            if (type == "shm" && arg.size())
+                return SinkFactory::create<ShmSink>(arg);
+            if (type == "dgram" && arg.size())
+                return SinkFactory::create<DgramSink>(arg);
+            std::cout << "无法识别的落地方向: " << spec << std::endl;
+            return LogSink::ptr();
+        }
+        static std::string trim(const std::string &str)
+        {
+            size_t begin = str.find_first_not_of(" \t\r\n");
+            if (begin == std::string::npos)
+                return "";
+            size_t end = str.find_last_not_of(" \t\r\n");
+            return str.substr(begin, end - begin + 1);
+        }
+    };
+
+    // 通过inotify监视配置文件，文件被修改或替换后重新加载
+    class ConfigWatcher
+    {
+    public:
+        ConfigWatcher(const std::string &pathname) : _pathname(pathname), _stop(false)
+        {
+            Config::load(_pathname);
+            _thread = std::thread(&ConfigWatcher::threadEntry, this);
+        }
+        ~ConfigWatcher()
+        {
+            _stop = true;
+            _thread.join();
+        }
+
+    private:
+        void threadEntry()
+        {
+            // 监视所在目录而不是文件本身：编辑器保存时通常会以重命名的方式替换文件
+            std::string dir = util::File::path(_pathname);
+            std::string filename = _pathname.substr(dir.size());
+            if (dir.empty())
+                dir = "./";
+            int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (fd < 0 || inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+            {
+                std::cout << "配置文件监视失败: " << _pathname << std::endl;
+                if (fd >= 0)
+                    close(fd);
+                return;
+            }
+            char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+            struct pollfd pfd = {fd, POLLIN, 0};
+            while (!_stop)
+            {
+                if (poll(&pfd, 1, 200) <= 0)
+                    continue;
+                bool changed = false;
+                ssize_t len;
+                while ((len = read(fd, buf, sizeof(buf))) > 0)
+                {
+                    for (char *ptr = buf; ptr < buf + len;)
+                    {
+                        struct inotify_event *event = reinterpret_cast<struct inotify_event *>(ptr);
+                        if (event->len && filename == event->name)
+                            changed = true;
+                        ptr += sizeof(struct inotify_event) + event->len;
+                    }
+                }
+                if (changed)
+                    Config::load(_pathname);
+            }
+            close(fd);
+        }
+
+    private:
+        std::string _pathname;
+        std::atomic<bool> _stop;
+        std::thread _thread;
+    };
+}
+
+#endif
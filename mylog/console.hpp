@@ -0,0 +1,262 @@
+#ifndef __MY_CONSOLE__
+#define __MY_CONSOLE__
+#include "util.hpp"
+#include "sink.hpp"
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+namespace mylog
+{
+#define DEFAULT_CONSOLE_PENDING (1024 * 1024)
+#define CONSOLE_CLOSE_TIMEOUT 1000
+
+    /*
+        落地方向：控制台，直接写文件描述符1/2，不经过iostream
+        split为true时WARN及以上的日志写到标准错误；输出到终端时按等级给整行加上ANSI颜色，
+        颜色码是预先准备好的字符串，作为单独的分段写出，不需要拷贝或改写日志
+        终端或管道写不进去时不等待：未写出的部分暂存在有上限的缓冲区中，下次写入时先写出暂存的数据，
+        暂存超过上限的日志直接丢弃并计数
+    */
+    class ConsoleSink : public LogSink
+    {
+    public:
+        ConsoleSink(bool split = true, size_t max_pending = DEFAULT_CONSOLE_PENDING)
+            : _split(split), _max_pending(max_pending), _dropped(0)
+        {
+            openStream(_streams[0], STDOUT_FILENO);
+            openStream(_streams[1], STDERR_FILENO);
+        }
+        ~ConsoleSink()
+        {
+            // 退出前尽量写出暂存的数据
+            for (auto &st : _streams)
+            {
+                for (int waited = 0; !drain(st) && waited < CONSOLE_CLOSE_TIMEOUT; waited += 10)
+                {
+                    struct pollfd pfd = {st.fd, POLLOUT, 0};
+                    poll(&pfd, 1, 10);
+                }
+                if (st.own)
+                    close(st.fd);
+            }
+        }
+        void log(const char *data, const size_t &len)
+        {
+            struct iovec iov = {const_cast<char *>(data), len};
+            log(&iov, 1);
+        }
+        void log(const struct iovec *iov, int iovcnt)
+        {
+            LogBatch batch = {iov, iovcnt, nullptr, 0};
+            log(batch);
+        }
+        void log(const LogBatch &batch)
+        {
+            _streams[0].iov.clear();
+            _streams[1].iov.clear();
+            if (batch.count == 0)
+            {
+                // 没有元信息时无法区分等级，全部写到标准输出
+                _streams[0].iov.assign(batch.iov, batch.iov + batch.iovcnt);
+            }
+            else
+            {
+                size_t seg = 0, off = 0;
+                for (size_t i = 0; i < batch.count; ++i)
+                {
+                    const LogRecord &rec = batch.records[i];
+                    Stream &st = _streams[_split && rec._level >= LogLevel::value::WARN ? 1 : 0];
+                    const char *color = st.color ? levelColor(rec._level) : nullptr;
+                    if (color)
+                        st.iov.push_back({const_cast<char *>(color), strlen(color)});
+                    // 从batch.iov中截取这条日志，可能跨越多个分段
+                    for (size_t left = rec._len; left > 0;)
+                    {
+                        size_t n = std::min(left, batch.iov[seg].iov_len - off);
+                        if (n)
+                            st.iov.push_back({static_cast<char *>(batch.iov[seg].iov_base) + off, n});
+                        left -= n;
+                        off += n;
+                        if (off == batch.iov[seg].iov_len)
+                            ++seg, off = 0;
+                    }
+                    if (color)
+                        resetColor(st);
+                }
+            }
+            write(_streams[0]);
+            write(_streams[1]);
+        }
+        // 尝试写出暂存的数据，不等待
+        void flush()
+        {
+            drain(_streams[0]);
+            drain(_streams[1]);
+        }
+        // 因暂存缓冲区已满而丢弃的字节数
+        size_t dropped()
+        {
+            return _dropped;
+        }
+
+    private:
+        enum : size_t
+        {
+            LEVEL_COUNT = (size_t)LogLevel::value::OFF + 1
+        };
+        struct Stream
+        {
+            int fd;
+            bool own;      // fd是否为重新打开的，需要关闭
+            bool nonblock; // fd是否为非阻塞，否则写之前用poll检查
+            bool color;    // 是否为终端，输出颜色
+            std::string pending;
+            size_t pending_pos;
+            std::vector<struct iovec> iov;
+        };
+        /*
+            终端、管道等会阻塞的目标通过/proc/self/fd重新打开，得到独立的、非阻塞的打开文件描述，
+            不影响进程中其他使用标准输出的代码；普通文件不会阻塞，直接使用原来的描述符以共享写入位置
+        */
+        static void openStream(Stream &st, int fd)
+        {
+            st.fd = fd;
+            st.own = false;
+            st.nonblock = false;
+            st.color = isatty(fd);
+            st.pending_pos = 0;
+            struct stat sb;
+            if (fstat(fd, &sb) == 0 && S_ISREG(sb.st_mode))
+            {
+                st.nonblock = true;
+                return;
+            }
+            char path[32];
+            snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+            int nfd = ::open(path, O_WRONLY | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
+            if (nfd >= 0)
+            {
+                st.fd = nfd;
+                st.own = true;
+                st.nonblock = true;
+            }
+        }
+        static const char *levelColor(LogLevel::value level)
+        {
+            static const char *colors[LEVEL_COUNT] = {nullptr, "\033[36m", "\033[32m", "\033[33m", "\033[31m", "\033[1;31m", nullptr};
+            return (size_t)level < LEVEL_COUNT ? colors[(size_t)level] : nullptr;
+        }
+        // 在行尾的换行符之前恢复颜色，避免颜色延续到下一行的提示符
+        static void resetColor(Stream &st)
+        {
+            static const char reset[] = "\033[0m";
+            static const char reset_nl[] = "\033[0m\n";
+            struct iovec &tail = st.iov.back();
+            if (tail.iov_len > 0 && static_cast<const char *>(tail.iov_base)[tail.iov_len - 1] == '\n')
+            {
+                --tail.iov_len;
+                st.iov.push_back({const_cast<char *>(reset_nl), sizeof(reset_nl) - 1});
+            }
+            else
+                st.iov.push_back({const_cast<char *>(reset), sizeof(reset) - 1});
+        }
+        bool writable(Stream &st)
+        {
+            if (st.nonblock)
+                return true;
+            struct pollfd pfd = {st.fd, POLLOUT, 0};
+            return poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLOUT);
+        }
+        // 写出暂存的数据，全部写完返回true
+        bool drain(Stream &st)
+        {
+            while (st.pending_pos < st.pending.size())
+            {
+                ssize_t n = !writable(st) ? (errno = EAGAIN, -1) : ::write(st.fd, st.pending.data() + st.pending_pos, st.pending.size() - st.pending_pos);
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                {
+                    // 已写出的部分较多时整理一次，避免暂存区无限增长
+                    if (st.pending_pos > st.pending.size() / 2)
+                    {
+                        st.pending.erase(0, st.pending_pos);
+                        st.pending_pos = 0;
+                    }
+                    return false;
+                }
+                if (n < 0)
+                {
+                    // 其他错误(例如对端已关闭)无法恢复，丢弃暂存的数据
+                    _dropped += st.pending.size() - st.pending_pos;
+                    break;
+                }
+                st.pending_pos += n;
+            }
+            st.pending.clear();
+            st.pending_pos = 0;
+            return true;
+        }
+        void write(Stream &st)
+        {
+            if (st.iov.empty())
+                return;
+            size_t idx = 0;
+            if (drain(st))
+            {
+                // 之前的数据已经写完，直接写新数据，写不完的部分转入暂存
+                while (idx < st.iov.size() && writable(st))
+                {
+                    int cnt = std::min(st.iov.size() - idx, (size_t)IOV_MAX);
+                    ssize_t n = writev(st.fd, &st.iov[idx], cnt);
+                    if (n < 0 && errno == EINTR)
+                        continue;
+                    if (n < 0)
+                    {
+                        if (errno != EAGAIN && errno != EWOULDBLOCK)
+                        {
+                            for (; idx < st.iov.size(); ++idx)
+                                _dropped += st.iov[idx].iov_len;
+                        }
+                        break;
+                    }
+                    for (; idx < st.iov.size() && (size_t)n >= st.iov[idx].iov_len; ++idx)
+                        n -= st.iov[idx].iov_len;
+                    if (n > 0)
+                    {
+                        st.iov[idx].iov_base = static_cast<char *>(st.iov[idx].iov_base) + n;
+                        st.iov[idx].iov_len -= n;
+                    }
+                }
+            }
+            size_t left = 0;
+            for (size_t i = idx; i < st.iov.size(); ++i)
+                left += st.iov[i].iov_len;
+            if (left == 0)
+                return;
+            if (st.pending.size() - st.pending_pos + left > _max_pending)
+            {
+                _dropped += left;
+                return;
+            }
+            for (; idx < st.iov.size(); ++idx)
+                st.pending.append(static_cast<const char *>(st.iov[idx].iov_base), st.iov[idx].iov_len);
+        }
+
+    private:
+        bool _split;
+        size_t _max_pending;
+        std::atomic<size_t> _dropped;
+        Stream _streams[2]; // 0:标准输出 1:标准错误
+    };
+}
+
+#endif
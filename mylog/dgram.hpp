@@ -0,0 +1,194 @@
+#ifndef __MY_DGRAM__
+#define __MY_DGRAM__
+#include "util.hpp"
+#include "sink.hpp"
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+namespace mylog
+{
+#define DGRAM_BATCH_SIZE 64
+#define DGRAM_MAX_SIZE (60 * 1024)
+#define DGRAM_RECONNECT_GAP 1
+
+    /*
+        落地方向：数据报套接字(本地syslog守护进程或日志收集器)
+        地址中含有'/'时使用Unix数据报套接字(例如"/dev/log")，否则按"ip:port"使用UDP
+        每行日志作为一个数据报发送，一次sendmmsg批量发送多条；套接字为非阻塞，
+        对端繁忙或不存在时直接丢弃并计数，断开后按固定间隔尝试重连，不会阻塞调用线程
+        地址无效时给出提示，之后的日志全部计入丢弃
+    */
+    class DgramSink : public LogSink
+    {
+    public:
+        DgramSink(const std::string &address, const std::string &prefix = "")
+            : _address(address), _prefix(prefix), _fd(-1), _last_connect(0), _addr_len(0), _sent(0), _dropped(0)
+        {
+            _msgs.resize(DGRAM_BATCH_SIZE);
+            _iovs.resize(DGRAM_BATCH_SIZE * 2);
+            if (parseAddress())
+                connect();
+            else
+                std::cout << "数据报地址无效: " << address << std::endl;
+        }
+        ~DgramSink()
+        {
+            if (_fd >= 0)
+                close(_fd);
+        }
+        void log(const char *data, const size_t &len)
+        {
+            // 按行切分，凑满一批就发送
+            size_t count = 0, pos = 0;
+            while (pos < len)
+            {
+                const char *end = static_cast<const char *>(memchr(data + pos, '\n', len - pos));
+                size_t line_len = end ? end - (data + pos) : len - pos;
+                if (line_len > 0)
+                {
+                    setMessage(count++, data + pos, std::min(line_len, (size_t)DGRAM_MAX_SIZE));
+                    if (count == DGRAM_BATCH_SIZE)
+                    {
+                        sendBatch(count);
+                        count = 0;
+                    }
+                }
+                pos += line_len + 1;
+            }
+            if (count)
+                sendBatch(count);
+        }
+        size_t sent()
+        {
+            return _sent;
+        }
+        size_t dropped()
+        {
+            return _dropped;
+        }
+
+    private:
+        void setMessage(size_t idx, const char *line, size_t len)
+        {
+            struct iovec *iov = &_iovs[idx * 2];
+            iov[0].iov_base = const_cast<char *>(_prefix.data());
+            iov[0].iov_len = _prefix.size();
+            iov[1].iov_base = const_cast<char *>(line);
+            iov[1].iov_len = len;
+            struct msghdr &hdr = _msgs[idx].msg_hdr;
+            memset(&hdr, 0, sizeof(hdr));
+            hdr.msg_iov = iov;
+            hdr.msg_iovlen = 2;
+        }
+        void sendBatch(size_t count)
+        {
+            size_t idx = 0;
+            while (idx < count)
+            {
+                if (_fd < 0 && !connect())
+                    break;
+                int ret = sendmmsg(_fd, &_msgs[idx], count - idx, MSG_DONTWAIT | MSG_NOSIGNAL);
+                if (ret > 0)
+                {
+                    idx += ret;
+                    _sent += ret;
+                    continue;
+                }
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS)
+                    break; // 对端接收缓冲区已满，丢弃本批剩余数据，不等待
+                if (errno == ECONNREFUSED || errno == ENOENT || errno == ENOTCONN)
+                {
+                    // 对端不存在：UDP下仅影响当前数据报，Unix套接字下需要重连
+                    if (isUnix())
+                    {
+                        close(_fd);
+                        _fd = -1;
+                        break;
+                    }
+                    ++idx;
+                    ++_dropped;
+                    continue;
+                }
+                ++idx; // 其他错误(例如EMSGSIZE)只丢弃当前这一条
+                ++_dropped;
+            }
+            _dropped += count - idx;
+        }
+        // 解析地址，失败时_addr_len保持为0，之后不再连接
+        bool parseAddress()
+        {
+            memset(&_addr, 0, sizeof(_addr));
+            if (isUnix())
+            {
+                struct sockaddr_un *un = reinterpret_cast<struct sockaddr_un *>(&_addr);
+                if (_address.size() >= sizeof(un->sun_path))
+                    return false;
+                un->sun_family = AF_UNIX;
+                strncpy(un->sun_path, _address.c_str(), sizeof(un->sun_path) - 1);
+                _addr_len = sizeof(struct sockaddr_un);
+                return true;
+            }
+            struct sockaddr_in *in = reinterpret_cast<struct sockaddr_in *>(&_addr);
+            size_t pos = _address.find_last_of(':');
+            if (pos == std::string::npos || pos + 1 == _address.size())
+                return false;
+            char *end = nullptr;
+            errno = 0;
+            long port = strtol(_address.c_str() + pos + 1, &end, 10);
+            if (errno != 0 || *end != '\0' || port <= 0 || port > 65535)
+                return false;
+            if (inet_pton(AF_INET, _address.substr(0, pos).c_str(), &in->sin_addr) != 1)
+                return false;
+            in->sin_family = AF_INET;
+            in->sin_port = htons(port);
+            _addr_len = sizeof(struct sockaddr_in);
+            return true;
+        }
+        bool connect()
+        {
+            if (_addr_len == 0)
+                return false;
+            time_t now = util::Date::getTime();
+            if (_last_connect != 0 && now - _last_connect < DGRAM_RECONNECT_GAP)
+                return false;
+            _last_connect = now;
+            int fd = socket(_addr.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (fd < 0)
+                return false;
+            if (::connect(fd, reinterpret_cast<struct sockaddr *>(&_addr), _addr_len) < 0)
+            {
+                close(fd);
+                return false;
+            }
+            _fd = fd;
+            return true;
+        }
+        bool isUnix()
+        {
+            return _address.find('/') != std::string::npos;
+        }
+
+    private:
+        std::string _address;
+        std::string _prefix; // 每个数据报的前缀，例如syslog的"<14>app: "
+        int _fd;
+        time_t _last_connect;
+        struct sockaddr_storage _addr;
+        socklen_t _addr_len; // 0表示地址无效
+        std::atomic<size_t> _sent;
+        std::atomic<size_t> _dropped;
+        std::vector<struct mmsghdr> _msgs;
+        std::vector<struct iovec> _iovs;
+    };
+}
+
+#endif
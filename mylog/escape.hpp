@@ -0,0 +1,206 @@
+#ifndef __MY_ESCAPE__
+#define __MY_ESCAPE__
+#include "buffer.hpp"
+#include <cstdint>
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ESCAPE_X86 1
+#endif
+
+namespace mylog
+{
+    /*
+        消息内容的转义：
+        ESCAPE_LINE 转义换行等控制字符(制表符除外)和反斜杠，保证一条日志只占一行，且转义结果可以还原
+        ESCAPE_JSON 按JSON字符串的规则完整转义(控制字符、双引号、反斜杠)
+        ESCAPE_UTF8 同时校验UTF-8编码，非法字节替换为U+FFFD
+        扫描使用SSE2/AVX2一次检查16/32字节(运行时根据CPU选择)，不需要处理的连续内容整段拷贝
+    */
+    enum EscapeFlag
+    {
+        ESCAPE_LINE = 0,
+        ESCAPE_JSON = 1,
+        ESCAPE_UTF8 = 2
+    };
+
+    class Escape
+    {
+    public:
+        using ScanFunc = size_t (*)(const char *, size_t, int);
+        // 对data转义后追加到out
+        static void escape(Buffer &out, const char *data, size_t len, int flags)
+        {
+            static const ScanFunc scan = scanner();
+            escape(out, data, len, flags, scan);
+        }
+        // 使用指定的扫描函数，供测试比较各实现的结果
+        static void escape(Buffer &out, const char *data, size_t len, int flags, ScanFunc scan)
+        {
+            size_t pos = 0;
+            while (pos < len)
+            {
+                size_t run = scan(data + pos, len - pos, flags);
+                if (run)
+                    out.push(data + pos, run);
+                pos += run;
+                if (pos < len)
+                    pos += escapeOne(out, data + pos, len - pos, flags);
+            }
+        }
+        // 根据CPU支持的指令集选择扫描函数
+        static ScanFunc scanner()
+        {
+#ifdef ESCAPE_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2"))
+                return scanAVX2;
+            return scanSSE2;
+#else
+            return scanScalar;
+#endif
+        }
+        // 返回第一个需要处理的字节的位置，没有则返回len
+        static size_t scanScalar(const char *data, size_t len, int flags)
+        {
+            for (size_t i = 0; i < len; ++i)
+            {
+                if (special((unsigned char)data[i], flags))
+                    return i;
+            }
+            return len;
+        }
+#ifdef ESCAPE_X86
+        static size_t scanSSE2(const char *data, size_t len, int flags)
+        {
+            const __m128i limit = _mm_set1_epi8(0x1f);
+            const __m128i tab = _mm_set1_epi8('\t');
+            const __m128i quote = _mm_set1_epi8('"');
+            const __m128i slash = _mm_set1_epi8('\\');
+            size_t i = 0;
+            for (; i + 16 <= len; i += 16)
+            {
+                __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+                // x <= 0x1f(无符号比较)即为控制字符
+                __m128i hit = _mm_cmpeq_epi8(_mm_max_epu8(x, limit), limit);
+                if (flags & ESCAPE_JSON)
+                    hit = _mm_or_si128(hit, _mm_cmpeq_epi8(x, quote));
+                else
+                    hit = _mm_andnot_si128(_mm_cmpeq_epi8(x, tab), hit);
+                hit = _mm_or_si128(hit, _mm_cmpeq_epi8(x, slash));
+                unsigned mask = _mm_movemask_epi8(hit);
+                if (flags & ESCAPE_UTF8)
+                    mask |= _mm_movemask_epi8(x); // 非ASCII字节交给标量代码校验
+                if (mask)
+                    return i + __builtin_ctz(mask);
+            }
+            return i + scanScalar(data + i, len - i, flags);
+        }
+        __attribute__((target("avx2"))) static size_t scanAVX2(const char *data, size_t len, int flags)
+        {
+            const __m256i limit = _mm256_set1_epi8(0x1f);
+            const __m256i tab = _mm256_set1_epi8('\t');
+            const __m256i quote = _mm256_set1_epi8('"');
+            const __m256i slash = _mm256_set1_epi8('\\');
+            size_t i = 0;
+            for (; i + 32 <= len; i += 32)
+            {
+                __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+                __m256i hit = _mm256_cmpeq_epi8(_mm256_max_epu8(x, limit), limit);
+                if (flags & ESCAPE_JSON)
+                    hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(x, quote));
+                else
+                    hit = _mm256_andnot_si256(_mm256_cmpeq_epi8(x, tab), hit);
+                hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(x, slash));
+                unsigned mask = _mm256_movemask_epi8(hit);
+                if (flags & ESCAPE_UTF8)
+                    mask |= _mm256_movemask_epi8(x);
+                if (mask)
+                    return i + __builtin_ctz(mask);
+            }
+            return i + scanScalar(data + i, len - i, flags);
+        }
+#endif
+
+    private:
+        static bool special(unsigned char ch, int flags)
+        {
+            if (ch < 0x20)
+                return (flags & ESCAPE_JSON) || ch != '\t';
+            if (ch == '\\' || (flags & ESCAPE_JSON && ch == '"'))
+                return true;
+            return (flags & ESCAPE_UTF8) && ch >= 0x80;
+        }
+        // 处理扫描停下的位置，返回消耗的字节数
+        static size_t escapeOne(Buffer &out, const char *data, size_t len, int flags)
+        {
+            unsigned char ch = data[0];
+            if (ch >= 0x80)
+            {
+                size_t n = utf8Length(data, len);
+                if (n)
+                    out.push(data, n);
+                else
+                    out.push("\xef\xbf\xbd", 3);
+                return n ? n : 1;
+            }
+            const char *rep = nullptr;
+            switch (ch)
+            {
+            case '\n':
+                rep = "\\n";
+                break;
+            case '\r':
+                rep = "\\r";
+                break;
+            case '\t':
+                rep = "\\t";
+                break;
+            case '"':
+                rep = "\\\"";
+                break;
+            case '\\':
+                rep = "\\\\";
+                break;
+            }
+            if (rep)
+            {
+                out.push(rep, 2);
+                return 1;
+            }
+            char tmp[8];
+            int n = snprintf(tmp, sizeof(tmp), (flags & ESCAPE_JSON) ? "\\u%04x" : "\\x%02x", ch);
+            out.push(tmp, n);
+            return 1;
+        }
+        // 合法的UTF-8字符返回其字节数，否则返回0
+        static size_t utf8Length(const char *data, size_t len)
+        {
+            const unsigned char *s = reinterpret_cast<const unsigned char *>(data);
+            size_t n;
+            uint32_t cp;
+            if (s[0] >= 0xc2 && s[0] <= 0xdf)
+                n = 2, cp = s[0] & 0x1f;
+            else if (s[0] >= 0xe0 && s[0] <= 0xef)
+                n = 3, cp = s[0] & 0x0f;
+            else if (s[0] >= 0xf0 && s[0] <= 0xf4)
+                n = 4, cp = s[0] & 0x07;
+            else
+                return 0;
+            if (n > len)
+                return 0;
+            for (size_t i = 1; i < n; ++i)
+            {
+                if ((s[i] & 0xc0) != 0x80)
+                    return 0;
+                cp = (cp << 6) | (s[i] & 0x3f);
+            }
+            // 排除过长编码、代理区以及超出范围的码点
+            if ((n == 3 && cp < 0x800) || (n == 4 && (cp < 0x10000 || cp > 0x10ffff)) || (cp >= 0xd800 && cp <= 0xdfff))
+                return 0;
+            return n;
+        }
+    };
+}
+
+#endif
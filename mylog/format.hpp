@@ -1,107 +1,283 @@
 #ifndef __MY_FORMAT__
 #define __MY_FORMAT__
 #include "message.hpp"
+#include "buffer.hpp"
+#include "escape.hpp"
 #include <sstream>
+#include <cstring>
+#include <algorithm>
 #include <cassert>
 #include <vector>
+#include <atomic>
 
 namespace mylog
 {
+#define FORMAT_BUFFER_SIZE (4 * 1024)
+#define FORMAT_MAX_IOV 16
+#define FORMAT_SPAN_MIN 64
+#define FORMAT_MAX_WIDTH 1024
+#define FORMAT_DEFAULT_PATTERN "[%d{%H:%M:%S}][%t][%c][%f:%l][%p]%T%m%n"
     class FormatItem
     {
     public:
         using ptr = std::shared_ptr<FormatItem>;
-        virtual void format(std::ostream &out, const logMsg &Msg) = 0;
+        virtual ~FormatItem() {}
+        virtual void format(Buffer &out, const logMsg &Msg) = 0;
+        // 格式化结果在消息处理期间保持不变时返回其地址，Formatter可以直接引用而不拷贝
+        virtual const std::string *span(const logMsg &Msg)
+        {
+            return nullptr;
+        }
     };
 
     class MsgFormatItem : public FormatItem
     {
     public:
-        void format(std::ostream &out, const logMsg &Msg)
+        // escape为true时按flags(见escape.hpp)对消息内容转义
+        MsgFormatItem(bool escape = false, int flags = ESCAPE_LINE) : _escape(escape), _flags(flags)
         {
-            out << Msg._payload;
         }
+        void format(Buffer &out, const logMsg &Msg)
+        {
+            if (_escape)
+                Escape::escape(out, Msg._payload.data(), Msg._payload.size(), _flags);
+            else
+                out.push(Msg._payload.data(), Msg._payload.size());
+        }
+        const std::string *span(const logMsg &Msg)
+        {
+            return _escape ? nullptr : &Msg._payload;
+        }
+
+    private:
+        bool _escape;
+        int _flags;
     };
 
+    // 各等级的输出字符串(含对齐填充和颜色)在构建时渲染好，格式化时按下标直接拷贝
     class LevelFormatItem : public FormatItem
     {
     public:
-        void format(std::ostream &out, const logMsg &Msg)
+        LevelFormatItem(size_t width = 0, bool left = false, bool color = false)
         {
-            out << LogLevel::toString(Msg._level);
+            static const char *colors[LEVEL_COUNT] = {"", "\033[36m", "\033[32m", "\033[33m", "\033[31m", "\033[1;31m", ""};
+            for (size_t i = 0; i < LEVEL_COUNT; ++i)
+            {
+                std::string name = pad(LogLevel::toString((LogLevel::value)i), width, left);
+                if (color && colors[i][0] != '\0')
+                    name = colors[i] + name + "\033[0m";
+                _names[i] = name;
+            }
+        }
+        void format(Buffer &out, const logMsg &Msg)
+        {
+            const std::string &name = _names[(size_t)Msg._level < LEVEL_COUNT ? (size_t)Msg._level : 0];
+            out.push(name.data(), name.size());
+        }
+        // 按宽度填充空格，left为true时左对齐
+        static std::string pad(const std::string &str, size_t width, bool left)
+        {
+            if (str.size() >= width)
+                return str;
+            if (left)
+                return str + std::string(width - str.size(), ' ');
+            return std::string(width - str.size(), ' ') + str;
         }
+
+    private:
+        enum
+        {
+            LEVEL_COUNT = (size_t)LogLevel::value::OFF + 1
+        };
+        std::string _names[LEVEL_COUNT];
     };
 
     class LineFormatItem : public FormatItem
     {
     public:
-        void format(std::ostream &out, const logMsg &Msg)
+        void format(Buffer &out, const logMsg &Msg)
         {
-            out << Msg._line;
+            char tmp[32];
+            int len = snprintf(tmp, sizeof(tmp), "%lu", (unsigned long)Msg._line);
+            out.push(tmp, len);
         }
     };
 
     class ThreadFormatItem : public FormatItem
     {
     public:
-        void format(std::ostream &out, const logMsg &Msg)
+        void format(Buffer &out, const logMsg &Msg)
         {
-            out << Msg._tid;
+            out.push(Msg._tid->str, Msg._tid->len);
         }
     };
 
     class LoggerFormatItem : public FormatItem
     {
     public:
-        void format(std::ostream &out, const logMsg &Msg)
+        void format(Buffer &out, const logMsg &Msg)
         {
-            out << Msg._logger;
+            out.push(Msg._logger.data(), Msg._logger.size());
         }
     };
 
     class FileFormatItem : public FormatItem
     {
     public:
-        void format(std::ostream &out, const logMsg &Msg)
+        void format(Buffer &out, const logMsg &Msg)
         {
-            out << Msg._file;
+            out.push(Msg._file, strlen(Msg._file));
         }
     };
 
+    /*
+        时间，子格式为strftime格式，另外支持秒以下的部分：%N为纳秒(9位)，%3N、%6N分别为毫秒、微秒(1~9表示位数)
+        strftime的结果在同一秒内不变，按线程缓存，每秒只调用一次localtime_r和strftime
+    */
     class TimeFormatItem : public FormatItem
     {
     public:
-        TimeFormatItem(const std::string &fmt = "%H:%M:%S") : _time_fmt(fmt)
+        TimeFormatItem(const std::string &fmt = "%H:%M:%S") : _time_fmt(fmt), _id(nextId())
+        {
+            parse(fmt);
+        }
+        void format(Buffer &out, const logMsg &Msg)
+        {
+            struct Cache
+            {
+                size_t id = 0;
+                time_t sec = 0;
+                std::vector<std::string> texts;
+            };
+            static thread_local Cache cache;
+            if (cache.id != _id || cache.sec != Msg._ctime)
+            {
+                struct tm t;
+                localtime_r(&Msg._ctime, &t);
+                cache.texts.resize(_parts.size());
+                for (size_t i = 0; i < _parts.size(); ++i)
+                    render(cache.texts[i], _parts[i], t);
+                cache.id = _id;
+                cache.sec = Msg._ctime;
+            }
+            int64_t frac = Msg._ns % 1000000000;
+            for (size_t i = 0; i < _parts.size(); ++i)
+            {
+                if (_parts[i].digits == 0)
+                {
+                    out.push(cache.texts[i].data(), cache.texts[i].size());
+                    continue;
+                }
+                char tmp[9];
+                int64_t val = frac;
+                for (int d = _parts[i].digits; d < 9; ++d)
+                    val /= 10;
+                for (int d = _parts[i].digits - 1; d >= 0; --d, val /= 10)
+                    tmp[d] = '0' + val % 10;
+                out.push(tmp, _parts[i].digits);
+            }
+        }
+
+    private:
+        struct Part
         {
+            std::string text; // strftime格式
+            int digits;       // 不为0时表示秒以下部分的位数
+        };
+        void parse(const std::string &fmt)
+        {
+            std::string text;
+            for (size_t i = 0; i < fmt.size(); ++i)
+            {
+                int digits = 0;
+                if (fmt[i] == '%' && i + 1 < fmt.size() && fmt[i + 1] == 'N')
+                    digits = 9, i += 1;
+                else if (fmt[i] == '%' && i + 2 < fmt.size() && fmt[i + 1] >= '1' && fmt[i + 1] <= '9' && fmt[i + 2] == 'N')
+                    digits = fmt[i + 1] - '0', i += 2;
+                else if (fmt[i] == '%' && i + 1 < fmt.size())
+                {
+                    text.append(fmt, i, 2); // 包括"%%"，原样交给strftime
+                    ++i;
+                    continue;
+                }
+                if (digits == 0)
+                {
+                    text.push_back(fmt[i]);
+                    continue;
+                }
+                if (text.size())
+                    _parts.push_back({text, 0});
+                text.clear();
+                _parts.push_back({"", digits});
+            }
+            if (text.size())
+                _parts.push_back({text, 0});
         }
-        void format(std::ostream &out, const logMsg &Msg)
+        // strftime在缓冲区不足和结果为空时都返回0，逐步扩大缓冲区重试，上限与格式长度成正比
+        static void render(std::string &out, const Part &part, const struct tm &t)
         {
-            struct tm t;
-            localtime_r(&Msg._ctime, &t);
-            char tmp[32] = {0};
-            strftime(tmp, 31, _time_fmt.c_str(), &t);
-            out << tmp;
+            size_t len = 0;
+            for (size_t size = 64; part.digits == 0 && size <= 64 + part.text.size() * 128; size *= 4)
+            {
+                out.resize(size);
+                len = strftime(&out[0], size, part.text.c_str(), &t);
+                if (len)
+                    break;
+            }
+            out.resize(len);
+        }
+        // 缓存以编号区分格式项，避免对象释放后地址被复用时取到旧的结果
+        static size_t nextId()
+        {
+            static std::atomic<size_t> id(0);
+            return ++id;
         }
 
     private:
         std::string _time_fmt;
+        std::vector<Part> _parts;
+        size_t _id;
+    };
+
+    // 诊断上下文(见mdc.hpp)：key为空时输出整个上下文，否则只输出该项的值(不存在时为空)
+    class MdcFormatItem : public FormatItem
+    {
+    public:
+        MdcFormatItem(const std::string &key = "") : _key(key)
+        {
+        }
+        void format(Buffer &out, const logMsg &Msg)
+        {
+            if (_key.empty())
+            {
+                out.push(Msg._mdc->data, Msg._mdc->len);
+                return;
+            }
+            const char *value;
+            size_t len;
+            if (Msg._mdc->find(_key.data(), _key.size(), value, len))
+                out.push(value, len);
+        }
+
+    private:
+        std::string _key;
     };
 
     class TabFormatItem : public FormatItem
     {
     public:
-        void format(std::ostream &out, const logMsg &Msg)
+        void format(Buffer &out, const logMsg &Msg)
         {
-            out << "\t";
+            out.push('\t');
         }
     };
 
     class NLineFormatItem : public FormatItem
     {
     public:
-        void format(std::ostream &out, const logMsg &Msg)
+        void format(Buffer &out, const logMsg &Msg)
         {
-            out << "\n";
+            out.push('\n');
         }
     };
 
@@ -111,18 +287,52 @@ namespace mylog
         OtherFormatItem(const std::string str) : _str(str)
         {
         }
-        void format(std::ostream &out, const logMsg &Msg)
+        void format(Buffer &out, const logMsg &Msg)
         {
-            out << _str;
+            out.push(_str.data(), _str.size());
+        }
+        const std::string *span(const logMsg &Msg)
+        {
+            return &_str;
         }
 
     private:
         std::string _str;
     };
 
+    // 对长度不固定的子项按宽度填充空格
+    class PadFormatItem : public FormatItem
+    {
+    public:
+        PadFormatItem(const FormatItem::ptr &item, size_t width, bool left)
+            : _item(item), _width(width), _left(left)
+        {
+        }
+        void format(Buffer &out, const logMsg &Msg)
+        {
+            size_t begin = out.readAbleSize();
+            _item->format(out, Msg);
+            size_t len = out.readAbleSize() - begin;
+            if (len >= _width)
+                return;
+            for (size_t i = len; i < _width; ++i)
+                out.push(' ');
+            if (_left)
+                return;
+            // 右对齐：把追加在末尾的空格轮换到内容前面
+            char *start = const_cast<char *>(out.begin()) + begin;
+            std::rotate(start, start + len, start + _width);
+        }
+
+    private:
+        FormatItem::ptr _item;
+        size_t _width;
+        bool _left;
+    };
+
     /*
-        %d 表示日期 ，包含子格式{%H:%M:%S}
-        %t 表示线程ID
+        %d 表示日期 ，包含子格式{%H:%M:%S}，子格式中%3N、%6N、%N分别为毫秒、微秒、纳秒
+        %t 表示线程ID(内核线程号，或util::Thread::setName设置的线程名)
         %c 表示日志器名称
         %f 表示源文件名
         %l 表示源码行号
@@ -130,93 +340,277 @@ namespace mylog
         %T 表示制表符缩进
         %m 表示主题消息
         %n 表示换行
+        %X 表示诊断上下文(MDC)，输出为"key1=value1 key2=value2"，%X{key}只输出其中一项的值
+        %和格式化字符之间可以指定宽度，例如%-5p左对齐到5个字符，%10c右对齐到10个字符
+        宽度不超过FORMAT_MAX_WIDTH
+        %p{color} 表示带ANSI颜色的日志级别
+        %m{escape} 转义消息中的换行等控制字符，%m{json} 按JSON字符串规则转义，追加",utf8"同时校验UTF-8，例如%m{json,utf8}，其余子格式在解析时报错
+        字面量、%T、%n以及日志器名称在构建时渲染并合并，格式化时只拷贝预先生成的内容
     */
     class Formatter
     {
     public:
         using ptr = std::shared_ptr<Formatter>;
-        Formatter(const std::string &pattern = "[%d{%H:%M:%S}][%t][%c][%f:%l][%p]%T%m%n") : _pattern(pattern)
+        // 格式有误时在标准错误中给出原因，并改用默认格式(见valid()、errorMessage())
+        Formatter(const std::string &pattern = FORMAT_DEFAULT_PATTERN, const std::string &logger_name = "")
+            : _pattern(pattern), _logger_name(logger_name)
         {
-            assert(parsePattern());
+            std::vector<FormatSpec> specs;
+            if (!parse(_pattern, specs, _error))
+            {
+                std::cerr << "日志格式\"" << _pattern << "\"有误: " << _error << "，改用默认格式" << std::endl;
+                _pattern = FORMAT_DEFAULT_PATTERN;
+                specs.clear();
+                std::string unused;
+                parse(_pattern, specs, unused);
+            }
+            build(specs);
         }
-        // 对msg进行格式化
-        void format(std::ostream &out, const logMsg &msg)
+        // 检查格式是否正确，有误时error中为原因
+        static bool check(const std::string &pattern, std::string *error = nullptr)
+        {
+            std::vector<FormatSpec> specs;
+            std::string err;
+            bool ret = parse(pattern, specs, err);
+            if (error)
+                *error = err;
+            return ret;
+        }
+        // 构造时给出的格式是否正确，有误时实际使用的是默认格式
+        bool valid()
+        {
+            return _error.empty();
+        }
+        const std::string &errorMessage()
+        {
+            return _error;
+        }
+        // 生成绑定了日志器名称的格式化器，日志器名称作为常量折叠到相邻的字面量中
+        Formatter::ptr bind(const std::string &logger_name)
+        {
+            return std::make_shared<Formatter>(_pattern, logger_name);
+        }
+        const std::string &pattern()
+        {
+            return _pattern;
+        }
+        // 对msg进行格式化，结果追加到out中
+        void format(Buffer &out, const logMsg &msg)
         {
             for (auto &item : _items)
                 item->format(out, msg);
         }
+        /*
+            分段格式化：较长且不变的内容(例如消息主体)不拷贝，直接作为单独的一段引用，
+            其余内容写入out，返回段数；在out被reset之前各段有效，可直接交给writev
+        */
+        int format(Buffer &out, const logMsg &msg, struct iovec *iov, int max_iov)
+        {
+            // 格式化过程中out可能扩容，先记录偏移，结束后再换算为地址
+            size_t offset[FORMAT_MAX_IOV];
+            size_t mark = out.readAbleSize();
+            int cnt = 0;
+            max_iov = std::min(max_iov, FORMAT_MAX_IOV);
+            for (auto &item : _items)
+            {
+                const std::string *span = item->span(msg);
+                if (span == nullptr || span->size() < FORMAT_SPAN_MIN || cnt + 3 > max_iov)
+                {
+                    item->format(out, msg);
+                    continue;
+                }
+                size_t cur = out.readAbleSize();
+                if (cur > mark)
+                {
+                    offset[cnt] = mark;
+                    iov[cnt].iov_base = nullptr;
+                    iov[cnt++].iov_len = cur - mark;
+                }
+                iov[cnt].iov_base = const_cast<char *>(span->data());
+                iov[cnt++].iov_len = span->size();
+                mark = cur;
+            }
+            size_t cur = out.readAbleSize();
+            if (cur > mark || cnt == 0)
+            {
+                offset[cnt] = mark;
+                iov[cnt].iov_base = nullptr;
+                iov[cnt++].iov_len = cur - mark;
+            }
+            for (int i = 0; i < cnt; ++i)
+            {
+                if (iov[i].iov_base == nullptr)
+                    iov[i].iov_base = const_cast<char *>(out.begin() + offset[i]);
+            }
+            return cnt;
+        }
+        void format(std::ostream &out, const logMsg &msg)
+        {
+            Buffer buf(FORMAT_BUFFER_SIZE);
+            format(buf, msg);
+            out.write(buf.begin(), buf.readAbleSize());
+        }
         std::string format(const logMsg &msg)
         {
-            std::stringstream ss;
-            format(ss, msg);
-            return ss.str();
+            Buffer buf(FORMAT_BUFFER_SIZE);
+            format(buf, msg);
+            return std::string(buf.begin(), buf.readAbleSize());
         }
-        // 对格式化规则字符串进行解析
+
     private:
-        bool parsePattern()
+        struct FormatSpec
+        {
+            std::string key;
+            std::string val;
+            size_t width; // 0表示不指定宽度
+            bool left;    // 是否左对齐
+        };
+        // 解析格式字符串，出错时error中为出错位置和原因
+        static bool parse(const std::string &pattern, std::vector<FormatSpec> &specs, std::string &error)
         {
-            std::vector<std::pair<std::string, std::string>> fmt_order;
             size_t pos = 0;
             std::string key, val;
-            while (pos < _pattern.size())
+            while (pos < pattern.size())
             {
-                if (_pattern[pos] != '%') // 处理OtherFormatItem类型
+                if (pattern[pos] != '%') // 处理OtherFormatItem类型
                 {
-                    val.push_back(_pattern[pos++]);
+                    val.push_back(pattern[pos++]);
                     continue;
                 }
 
                 if (val.size()) // 把OtherFormatItem先push进去
                 {
-                    fmt_order.push_back({"", val});
+                    specs.push_back({"", val, 0, false});
                     val.clear();
                     continue;
                 }
 
-                if (_pattern.size() == pos + 1)
-                {
-                    std::cout << "'%'后面没有其他字符，解析出错" << std::endl;
-                    return false;
-                }
+                size_t start = pos;
+                if (pattern.size() == pos + 1)
+                    return fail(error, start, "'%'后面没有其他字符");
 
-                if (_pattern[pos + 1] == '%') // 这是"%%"的情况,那就只输出一个"%"
+                if (pattern[pos + 1] == '%') // 这是"%%"的情况,那就只输出一个"%"
                 {
                     val.push_back('%');
                     pos += 2;
                     continue;
                 }
 
-                // 到这里说明存在"%"且，"%"后面不为"%"
-                key = _pattern[pos + 1];
-                pos += 2;
-                if (pos < _pattern.size() && _pattern[pos] == '{') // 说明遇到了子串情况
+                // 到这里说明存在"%"且，"%"后面不为"%"，先解析可选的对齐方式和宽度
+                ++pos;
+                bool left = false;
+                size_t width = 0;
+                if (pattern[pos] == '-')
                 {
+                    left = true;
                     ++pos;
-                    while (pos < _pattern.size() && _pattern[pos] != '}')
-                    {
-                        val.push_back(_pattern[pos++]);
-                    }
-                    if (pos == _pattern.size())
+                }
+                while (pos < pattern.size() && isdigit((unsigned char)pattern[pos]))
+                {
+                    width = width * 10 + (pattern[pos++] - '0');
+                    if (width > FORMAT_MAX_WIDTH)
+                        return fail(error, start, "宽度过大");
+                }
+                if (pos == pattern.size())
+                    return fail(error, start, "宽度说明后面没有格式化字符");
+                key = pattern[pos++];
+                if (key.find_first_of("dtcflpTmnX") == std::string::npos)
+                    return fail(error, start, "未知的格式化字符'" + key + "'");
+                if (pos < pattern.size() && pattern[pos] == '{') // 说明遇到了子串情况
+                {
+                    ++pos;
+                    while (pos < pattern.size() && pattern[pos] != '}')
                     {
-                        std::cout << "子串匹配错误,未匹配到'}'" << std::endl;
-                        return false;
+                        val.push_back(pattern[pos++]);
                     }
+                    if (pos == pattern.size())
+                        return fail(error, start, "子串没有匹配的'}'");
                     ++pos; // 这里就说明匹配到了'}'
                 }
-                fmt_order.push_back({key, val});
+                int flags;
+                if (key == "m" && val.size() && !msgFlags(val, flags))
+                    return fail(error, start, "未知的消息子格式'" + val + "'，只能是escape或json，可追加\",utf8\"");
+                specs.push_back({key, val, width, left});
                 key.clear();
                 val.clear();
             }
-            for (auto &it : fmt_order)
-                _items.push_back(createItem(it.first, it.second));
-            //_items.push_back(createItem("n",""));
+            if (val.size()) // 结尾的字面量
+                specs.push_back({"", val, 0, false});
+            return true;
+        }
+        // %m的子格式：escape或json，可追加",utf8"
+        static bool msgFlags(const std::string &val, int &flags)
+        {
+            size_t comma = val.find(',');
+            std::string mode = val.substr(0, comma);
+            if (mode == "escape")
+                flags = ESCAPE_LINE;
+            else if (mode == "json")
+                flags = ESCAPE_JSON;
+            else
+                return false;
+            if (comma == std::string::npos)
+                return true;
+            flags |= ESCAPE_UTF8;
+            return val.compare(comma + 1, std::string::npos, "utf8") == 0;
+        }
+        static bool fail(std::string &error, size_t pos, const std::string &reason)
+        {
+            error = "位置" + std::to_string(pos) + ": " + reason;
+            return false;
+        }
+        // 常量部分渲染后与相邻的字面量合并为一个子项
+        void build(const std::vector<FormatSpec> &specs)
+        {
+            std::string text;
+            for (auto &spec : specs)
+            {
+                std::string folded;
+                if (foldConstant(spec, folded))
+                {
+                    text += folded;
+                    continue;
+                }
+                if (text.size())
+                {
+                    _items.push_back(std::make_shared<OtherFormatItem>(text));
+                    text.clear();
+                }
+                _items.push_back(createItem(spec));
+            }
+            if (text.size())
+                _items.push_back(std::make_shared<OtherFormatItem>(text));
+        }
+        // 输出与消息无关的子项在构建时直接渲染为字符串
+        bool foldConstant(const FormatSpec &spec, std::string &folded)
+        {
+            if (spec.key == "")
+                folded = spec.val;
+            else if (spec.key == "T")
+                folded = "\t";
+            else if (spec.key == "n")
+                folded = "\n";
+            else if (spec.key == "c" && _logger_name.size())
+                folded = _logger_name;
+            else
+                return false;
+            folded = LevelFormatItem::pad(folded, spec.width, spec.left);
             return true;
         }
         // 根据不同的格式化字符创建不同的格式化子项对象
+        FormatItem::ptr createItem(const FormatSpec &spec)
+        {
+            if (spec.key == "p")
+                return std::make_shared<LevelFormatItem>(spec.width, spec.left, spec.val == "color");
+            FormatItem::ptr item = createItem(spec.key, spec.val);
+            if (spec.width)
+                return std::make_shared<PadFormatItem>(item, spec.width, spec.left);
+            return item;
+        }
         FormatItem::ptr createItem(const std::string &key, const std::string &val)
         {
-            if (key == "d")
-                return std::make_shared<TimeFormatItem>(val);
+            if (key == "d") // 没有子格式时使用默认的时间格式
+                return val.empty() ? std::make_shared<TimeFormatItem>() : std::make_shared<TimeFormatItem>(val);
             if (key == "t")
                 return std::make_shared<ThreadFormatItem>();
             if (key == "c")
@@ -230,18 +624,25 @@ namespace mylog
             if (key == "T")
                 return std::make_shared<TabFormatItem>();
             if (key == "m")
-                return std::make_shared<MsgFormatItem>();
+            {
+                if (val.empty())
+                    return std::make_shared<MsgFormatItem>();
+                int flags = ESCAPE_LINE;
+                msgFlags(val, flags); // 子格式在解析时已经校验
+                return std::make_shared<MsgFormatItem>(true, flags);
+            }
             if (key == "n")
                 return std::make_shared<NLineFormatItem>();
-            if (key == "")
-                return std::make_shared<OtherFormatItem>(val);
-            std::cout << "输入格式错误！" << std::endl;
-            abort();
+            if (key == "X")
+                return std::make_shared<MdcFormatItem>(val);
+            // 其余字符在解析时已经报错，不会到达这里
             return std::make_shared<OtherFormatItem>(val);
         }
 
     private:
-        std::string _pattern; // 格式化规则字符串
+        std::string _pattern;     // 格式化规则字符串
+        std::string _error;       // 构造时的解析错误，为空表示格式正确
+        std::string _logger_name; // 绑定的日志器名称，为空时%c在格式化时输出
         std::vector<FormatItem::ptr> _items;
     };
 }
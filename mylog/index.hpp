@@ -0,0 +1,208 @@
+#ifndef __MY_INDEX__
+#define __MY_INDEX__
+#include "util.hpp"
+#include "message.hpp"
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+namespace mylog
+{
+#define INDEX_BLOCK_SIZE (64 * 1024)
+#define INDEX_LEVEL_COUNT 7
+#define INDEX_SUFFIX ".idx"
+
+    /*
+        日志文件的稀疏索引：日志文件按记录边界切分为约INDEX_BLOCK_SIZE大小的块，
+        每块在旁路文件(日志文件名 + ".idx")中追加一个定长条目，记录块的偏移、时间范围、
+        各等级的条数以及日志器名称的布隆过滤器；查询时只需读取索引即可定位到相关的块
+    */
+    struct IndexBlock
+    {
+        uint64_t offset;                       // 块在日志文件中的起始偏移
+        uint64_t length;                       // 块的字节数
+        int64_t begin_time;                    // 块中最早的时间戳
+        int64_t end_time;                      // 块中最晚的时间戳
+        uint32_t records;                      // 记录条数
+        uint32_t levels[INDEX_LEVEL_COUNT];    // 各等级的记录条数
+        uint64_t bloom[4];                     // 日志器名称的布隆过滤器(256位)
+
+        // 过滤器中对应名称的3个位
+        static void bloomBits(const std::string &name, size_t bits[3])
+        {
+            uint64_t h = 1469598103934665603ULL; // FNV-1a
+            for (unsigned char ch : name)
+                h = (h ^ ch) * 1099511628211ULL;
+            bits[0] = h & 255;
+            bits[1] = (h >> 8) & 255;
+            bits[2] = (h >> 16) & 255;
+        }
+        void addLogger(const size_t bits[3])
+        {
+            for (int i = 0; i < 3; ++i)
+                bloom[bits[i] / 64] |= 1ULL << (bits[i] % 64);
+        }
+        // 可能包含该日志器时返回true(存在误判，不会漏判)
+        bool mayContain(const std::string &name) const
+        {
+            size_t bits[3];
+            bloomBits(name, bits);
+            for (int i = 0; i < 3; ++i)
+            {
+                if (!(bloom[bits[i] / 64] & (1ULL << (bits[i] % 64))))
+                    return false;
+            }
+            return true;
+        }
+        // 块中是否有不低于level的日志
+        bool hasLevel(LogLevel::value level) const
+        {
+            for (size_t i = (size_t)level; i < INDEX_LEVEL_COUNT; ++i)
+            {
+                if (levels[i])
+                    return true;
+            }
+            return false;
+        }
+    };
+
+    // 随日志写入增量生成索引，由落地方向在每次写入后调用
+    class IndexWriter
+    {
+    public:
+        IndexWriter() : _fd(-1), _file_size(0)
+        {
+            IndexBlock::bloomBits(_last_logger, _last_bits);
+            clearBlock();
+        }
+        ~IndexWriter()
+        {
+            close();
+        }
+        // 开始为新的日志文件建立索引，file_size为文件已有的长度
+        void open(const std::string &log_pathname, size_t file_size)
+        {
+            close();
+            _fd = util::File::openAppend(log_pathname + INDEX_SUFFIX);
+            _file_size = file_size;
+            clearBlock();
+        }
+        // 结束当前文件：把未满的块也写入索引
+        void close()
+        {
+            int fd = release();
+            if (fd >= 0)
+                ::close(fd);
+        }
+        // 使用已经打开的索引文件，不在调用线程中进行打开文件等操作
+        void attach(int fd, size_t file_size)
+        {
+            close();
+            _fd = fd;
+            _file_size = file_size;
+            clearBlock();
+        }
+        // 结束当前文件并交出索引文件的描述符(由调用者关闭)，没有打开时返回-1
+        int release()
+        {
+            if (_fd < 0)
+                return -1;
+            flushBlock();
+            int fd = _fd;
+            _fd = -1;
+            return fd;
+        }
+        // 记录已经写入日志文件的若干条日志，written为实际写入的字节数(部分写入时只计入已写入的记录和字节)
+        void append(const LogRecord *records, size_t count, size_t written)
+        {
+            if (_fd < 0)
+                return;
+            for (size_t i = 0; i < count && written > 0; ++i)
+            {
+                const LogRecord &rec = records[i];
+                size_t len = std::min(rec._len, written);
+                written -= len;
+                if (_block.length >= INDEX_BLOCK_SIZE)
+                    flushBlock();
+                if (_block.records == 0 || rec._ctime < _block.begin_time)
+                    _block.begin_time = rec._ctime;
+                if (_block.records == 0 || rec._ctime > _block.end_time)
+                    _block.end_time = rec._ctime;
+                ++_block.records;
+                ++_block.levels[(size_t)rec._level < INDEX_LEVEL_COUNT ? (size_t)rec._level : 0];
+                // 连续的记录通常来自同一个日志器，缓存其哈希结果；按名称比较，日志器销毁后地址可能被新的日志器重用
+                if (*rec._logger != _last_logger)
+                {
+                    _last_logger = *rec._logger;
+                    IndexBlock::bloomBits(_last_logger, _last_bits);
+                }
+                _block.addLogger(_last_bits);
+                _block.length += len;
+                _file_size += len;
+            }
+            // 没有对应记录的数据
+            if (written)
+                skip(written);
+        }
+        // 没有元信息的数据只计入块的长度，保证后续块的偏移正确
+        void skip(size_t len)
+        {
+            _block.length += len;
+            _file_size += len;
+        }
+
+    private:
+        void clearBlock()
+        {
+            memset(&_block, 0, sizeof(_block));
+            _block.offset = _file_size;
+        }
+        void flushBlock()
+        {
+            if (_block.length)
+                util::File::writeAll(_fd, reinterpret_cast<const char *>(&_block), sizeof(_block));
+            clearBlock();
+        }
+
+    private:
+        int _fd;
+        size_t _file_size;
+        IndexBlock _block; // 正在累积的块
+        std::string _last_logger; // _last_bits对应的日志器名称
+        size_t _last_bits[3];
+    };
+
+    // 读取日志文件的索引，并按条件筛选块
+    class IndexReader
+    {
+    public:
+        struct Query
+        {
+            int64_t begin_time = 0;
+            int64_t end_time = INT64_MAX;
+            LogLevel::value level = LogLevel::value::UNKOWN;
+            std::string logger; // 为空表示不限
+        };
+        static bool load(const std::string &log_pathname, std::vector<IndexBlock> &blocks)
+        {
+            int fd = ::open((log_pathname + INDEX_SUFFIX).c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+                return false;
+            IndexBlock block;
+            while (read(fd, &block, sizeof(block)) == (ssize_t)sizeof(block))
+                blocks.push_back(block);
+            ::close(fd);
+            return true;
+        }
+        static bool match(const IndexBlock &block, const Query &query)
+        {
+            if (block.end_time < query.begin_time || block.begin_time > query.end_time)
+                return false;
+            if (!block.hasLevel(query.level))
+                return false;
+            return query.logger.empty() || block.mayContain(query.logger);
+        }
+    };
+}
+
+#endif
@@ -1,5 +1,8 @@
 #ifndef __LEVEL__
 #define __LEVEL__
+#include <cstddef>
+#include <string>
+#include <strings.h>
 namespace mylog
 {
     class LogLevel
@@ -17,22 +20,22 @@ namespace mylog
         };
         static const char *toString(const LogLevel::value &level)
         {
-            switch (level)
+            // 按枚举值直接查表
+            static const char *names[] = {"UNKOWN", "DEBUG", "INFO", "WARN", "ERROR", "FATAL", "OFF"};
+            size_t idx = (size_t)level;
+            if (idx >= sizeof(names) / sizeof(names[0]))
+                return "UNKOWN";
+            return names[idx];
+        }
+        // 由等级名称得到等级(不区分大小写)，无法识别时返回UNKOWN
+        static LogLevel::value fromString(const std::string &name)
+        {
+            for (size_t i = (size_t)value::DEBUG; i <= (size_t)value::OFF; ++i)
             {
-            case LogLevel::value::OFF:
-                return "OFF";
-            case LogLevel::value::DEBUG:
-                return "DEBUG";
-            case LogLevel::value::INFO:
-                return "INFO";
-            case LogLevel::value::WARN:
-                return "WARN";
-            case LogLevel::value::ERROR:
-                return "ERROR";
-            case LogLevel::value::FATAL:
-                return "FATAL";
+                if (strcasecmp(name.c_str(), toString((value)i)) == 0)
+                    return (value)i;
             }
-            return "UNKOWN";
+            return value::UNKOWN;
         }
     };
 }
@@ -8,143 +8,648 @@
 #include "level.hpp"
 #include "format.hpp"
 #include "looper.hpp"
+#include "spill.hpp"
 #include <unordered_map>
 #include <atomic>
 #include <stdarg.h>
 #include <mutex>
+#if defined(__cpp_impl_coroutine) && __cplusplus >= 202002L
+#include <coroutine>
+#define MYLOG_COROUTINE 1
+#endif
 
 namespace mylog
 {
+#define DEFAULT_FLUSH_TIMEOUT 1000 // 按等级触发刷新时的最长等待时间(毫秒)
+#define TRUNCATE_MARK_SIZE 64      // 截断标记的最大长度
+    // 日志写入异步缓冲区的方式
+    enum PushMode
+    {
+        PUSH_BLOCK,  // 缓冲区已满时等待(默认)
+        PUSH_TRY,    // 缓冲区已满时丢弃
+        PUSH_NOTIFY  // 缓冲区已满时排队，写入后调用notify并将pending减1
+    };
+    // 不阻塞写日志(tryLog)的结果
+    enum class LogStatus
+    {
+        OK,       // 已写入(异步日志器为已写入缓冲区)
+        FILTERED, // 低于输出等级或没有落地方向需要，未处理
+        FULL,     // 异步缓冲区已满，日志被丢弃
+        FAILED    // 消息格式化失败
+    };
     class Logger
     {
     public:
         using ptr = std::shared_ptr<Logger>;
         Logger(const LogLevel::value &level, const std::string &logger_name, Formatter::ptr &formatter, std::vector<LogSink::ptr> &sink)
-            : _limit_level(level), _logger_name(logger_name), _formatter(formatter), _sink(sink.begin(), sink.end())
+            : _limit_level(level), _flush_level(LogLevel::value::OFF), _max_message_size(0), _logger_name(logger_name), _plan(nullptr), _plan_readers(0), _sink(sink.begin(), sink.end()),
+              _own_level(true), _own_formatter(true), _own_sinks(!sink.empty()), _sink_owner(this)
         {
+            installFormatter(formatter);
+        }
+        virtual ~Logger()
+        {
+            std::unique_lock<std::mutex> lock(treeMutex());
+            if (_parent)
+            {
+                auto &siblings = _parent->_children;
+                siblings.erase(std::remove(siblings.begin(), siblings.end(), this), siblings.end());
+            }
         }
         const std::string &getLoggerName()
         {
             return _logger_name;
         }
+        LogLevel::value getLevel()
+        {
+            return _limit_level;
+        }
+        // 运行时调整输出等级，对之后的日志立即生效；没有单独设置等级的子孙日志器随之改变
+        void setLevel(LogLevel::value level)
+        {
+            std::unique_lock<std::mutex> lock(treeMutex());
+            _own_level = true;
+            propagateLevel(level);
+        }
+        // 等级不低于level的日志写入后立即刷新，OFF表示不启用
+        void setFlushLevel(LogLevel::value level)
+        {
+            _flush_level = level;
+        }
+        /*
+            消息主体的最大字节数，0表示不限制：超出的部分被丢弃，末尾加上"...[truncated N bytes]"(N为丢弃的字节数)；
+            设置了溢出文件时完整内容写入溢出文件，标记为"...[spilled N bytes: 编号]"(N为完整的字节数)
+            实时日志器的消息主体由槽的大小限制，不受此设置影响
+            限制对之后的日志立即生效，超长消息只格式化保留的部分，不会为其申请大块内存
+        */
+        void setMaxMessageSize(size_t size)
+        {
+            _max_message_size = size;
+        }
+        size_t getMaxMessageSize()
+        {
+            return _max_message_size;
+        }
+        // 超长消息的溢出文件，需要在写日志之前设置
+        void setSpillFile(const SpillFile::ptr &spill)
+        {
+            _spill = spill;
+        }
+        // 等待已经写入的日志全部落地并刷新各落地方向，timeout_ms小于0时一直等待，超时返回false
+        virtual bool flush(int timeout_ms = -1) = 0;
+        // 运行时原子替换格式化器，正在格式化的线程继续使用旧的格式化器，已经进入缓冲区的日志不受影响
+        void setFormatter(const Formatter::ptr &formatter)
+        {
+            std::unique_lock<std::mutex> lock(treeMutex());
+            _own_formatter = true;
+            propagateFormatter(formatter);
+        }
+        // 当前使用的格式化器(未绑定日志器名称)
+        Formatter::ptr getFormatter()
+        {
+            std::unique_lock<std::mutex> lock(treeMutex());
+            return _base_formatter;
+        }
+        /*
+            层级关系：名称以'.'分隔(例如db.pool.conn)，由LoggerManager在登记时连接到最近的已存在的祖先
+            没有单独设置的等级、格式和落地方向继承自父日志器，继承的结果直接保存在日志器自身，写日志时不需要查找；
+            没有落地方向的日志器把格式化后的日志交给最近的有落地方向的祖先输出
+            level/formatter为true表示该项继承自父日志器(需要在连接到父日志器之前设置)
+        */
+        void setInherited(bool level, bool formatter)
+        {
+            _own_level = !level;
+            _own_formatter = !formatter;
+        }
+        void setParent(const ptr &parent)
+        {
+            std::unique_lock<std::mutex> lock(treeMutex());
+            if (_parent)
+            {
+                auto &siblings = _parent->_children;
+                siblings.erase(std::remove(siblings.begin(), siblings.end(), this), siblings.end());
+            }
+            _parent = parent;
+            parent->_children.push_back(this);
+            inherit();
+        }
+        ptr getParent()
+        {
+            std::unique_lock<std::mutex> lock(treeMutex());
+            return _parent;
+        }
+        // 当前的直接子日志器
+        std::vector<Logger *> getChildren()
+        {
+            std::unique_lock<std::mutex> lock(treeMutex());
+            return _children;
+        }
         // 完成日志消息对象过程并进行格式化，得到格式化后的日志消息，随后进行落地输出
-        void debug(const std::string &file, const size_t &line, const std::string &fmt, ...)
+        // fmt为字符串常量时使用const char *版本，避免每次调用构造std::string
+        void debug(const char *file, const size_t &line, const char *fmt, ...)
         {
-            // 先判断当前日志是否达到输出等级n
+            // 先判断当前日志是否达到输出等级
             if (LogLevel::value::DEBUG < _limit_level)
                 return;
-            // 对fmt格式化字符串和不定参进行字符串组织，得到日志消息字符串
             va_list ap;
             va_start(ap, fmt);
-            char *res;
-            int ret = vasprintf(&res, fmt.c_str(), ap);
-            if (ret == -1)
-            {
-                std::cout << "vasprintf failed!\n";
+            logv(LogLevel::value::DEBUG, file, line, fmt, ap, PUSH_BLOCK);
+            va_end(ap);
+        }
+        void debug(const char *file, const size_t &line, const std::string &fmt, ...)
+        {
+            // 先判断当前日志是否达到输出等级
+            if (LogLevel::value::DEBUG < _limit_level)
                 return;
-            }
+            va_list ap;
+            va_start(ap, fmt);
+            logv(LogLevel::value::DEBUG, file, line, fmt.c_str(), ap, PUSH_BLOCK);
             va_end(ap);
-            serialize(LogLevel::value::DEBUG, file, line, res);
-            free(res);
         }
-        void info(const std::string &file, const size_t &line, const std::string &fmt, ...)
+        void info(const char *file, const size_t &line, const char *fmt, ...)
         {
             // 先判断当前日志是否达到输出等级
             if (LogLevel::value::INFO < _limit_level)
                 return;
-            // 对fmt格式化字符串和不定参进行字符串组织，得到日志消息字符串
             va_list ap;
             va_start(ap, fmt);
-            char *res;
-            int ret = vasprintf(&res, fmt.c_str(), ap);
-            if (ret == -1)
-            {
-                std::cout << "vasprintf failed!\n";
+            logv(LogLevel::value::INFO, file, line, fmt, ap, PUSH_BLOCK);
+            va_end(ap);
+        }
+        void info(const char *file, const size_t &line, const std::string &fmt, ...)
+        {
+            // 先判断当前日志是否达到输出等级
+            if (LogLevel::value::INFO < _limit_level)
                 return;
-            }
+            va_list ap;
+            va_start(ap, fmt);
+            logv(LogLevel::value::INFO, file, line, fmt.c_str(), ap, PUSH_BLOCK);
             va_end(ap);
-            serialize(LogLevel::value::INFO, file, line, res);
-            free(res);
         }
-        void warn(const std::string &file, const size_t &line, const std::string &fmt, ...)
+        void warn(const char *file, const size_t &line, const char *fmt, ...)
         {
             // 先判断当前日志是否达到输出等级
             if (LogLevel::value::WARN < _limit_level)
                 return;
-            // 对fmt格式化字符串和不定参进行字符串组织，得到日志消息字符串
             va_list ap;
             va_start(ap, fmt);
-            char *res;
-            int ret = vasprintf(&res, fmt.c_str(), ap);
-            if (ret == -1)
-            {
-                std::cout << "vasprintf failed!\n";
+            logv(LogLevel::value::WARN, file, line, fmt, ap, PUSH_BLOCK);
+            va_end(ap);
+        }
+        void warn(const char *file, const size_t &line, const std::string &fmt, ...)
+        {
+            // 先判断当前日志是否达到输出等级
+            if (LogLevel::value::WARN < _limit_level)
                 return;
-            }
+            va_list ap;
+            va_start(ap, fmt);
+            logv(LogLevel::value::WARN, file, line, fmt.c_str(), ap, PUSH_BLOCK);
             va_end(ap);
-            serialize(LogLevel::value::WARN, file, line, res);
-            free(res);
         }
-        void error(const std::string &file, const size_t &line, const std::string &fmt, ...)
+        void error(const char *file, const size_t &line, const char *fmt, ...)
         {
             // 先判断当前日志是否达到输出等级
             if (LogLevel::value::ERROR < _limit_level)
                 return;
-            // 对fmt格式化字符串和不定参进行字符串组织，得到日志消息字符串
             va_list ap;
             va_start(ap, fmt);
-            char *res;
-            int ret = vasprintf(&res, fmt.c_str(), ap);
-            if (ret == -1)
-            {
-                std::cout << "vasprintf failed!\n";
+            logv(LogLevel::value::ERROR, file, line, fmt, ap, PUSH_BLOCK);
+            va_end(ap);
+        }
+        void error(const char *file, const size_t &line, const std::string &fmt, ...)
+        {
+            // 先判断当前日志是否达到输出等级
+            if (LogLevel::value::ERROR < _limit_level)
                 return;
-            }
+            va_list ap;
+            va_start(ap, fmt);
+            logv(LogLevel::value::ERROR, file, line, fmt.c_str(), ap, PUSH_BLOCK);
             va_end(ap);
-            serialize(LogLevel::value::ERROR, file, line, res);
-            free(res);
         }
-        void fatal(const std::string &file, const size_t &line, const std::string &fmt, ...)
+        void fatal(const char *file, const size_t &line, const char *fmt, ...)
         {
             // 先判断当前日志是否达到输出等级
             if (LogLevel::value::FATAL < _limit_level)
                 return;
-            // 对fmt格式化字符串和不定参进行字符串组织，得到日志消息字符串
             va_list ap;
             va_start(ap, fmt);
-            char *res;
-            int ret = vasprintf(&res, fmt.c_str(), ap);
-            if (ret == -1)
-            {
-                std::cout << "vasprintf failed!\n";
+            logv(LogLevel::value::FATAL, file, line, fmt, ap, PUSH_BLOCK);
+            va_end(ap);
+        }
+        void fatal(const char *file, const size_t &line, const std::string &fmt, ...)
+        {
+            // 先判断当前日志是否达到输出等级
+            if (LogLevel::value::FATAL < _limit_level)
                 return;
-            }
+            va_list ap;
+            va_start(ap, fmt);
+            logv(LogLevel::value::FATAL, file, line, fmt.c_str(), ap, PUSH_BLOCK);
             va_end(ap);
-            serialize(LogLevel::value::FATAL, file, line, res);
-            free(res);
         }
+        /*
+            不阻塞的写日志，立即返回结果：异步日志器(ASYNC_SAFE)缓冲区空间不足时丢弃并返回FULL，
+            适合不能阻塞的线程(例如事件循环)；不触发按等级刷新
+        */
+        LogStatus tryLog(LogLevel::value level, const char *file, size_t line, const char *fmt, ...)
+        {
+            if (level < _limit_level)
+                return LogStatus::FILTERED;
+            va_list ap;
+            va_start(ap, fmt);
+            LogStatus status = logv(level, file, line, fmt, ap, PUSH_TRY);
+            va_end(ap);
+            return status;
+        }
+#ifdef MYLOG_COROUTINE
+        /*
+            协程中使用的写日志和刷新：需要等待缓冲区空间或数据落地时挂起协程而不阻塞线程
+                co_await logger->logAsync(LogLevel::value::INFO, __FILE__, __LINE__, "x=%d", x);
+                co_await logger->flushAsync();
+            协程默认在异步线程中恢复，此时不能再进行阻塞的操作；通过resumer可以把恢复交给协程所在的执行器
+        */
+        using Resumer = std::function<void(std::coroutine_handle<>)>;
+        class LogAwaiter
+        {
+        public:
+            LogAwaiter(Logger *logger, LogLevel::value level, const char *file, size_t line, std::string payload, const Resumer &resumer)
+                : _logger(logger), _level(level), _file(file), _line(line), _payload(std::move(payload)), _resumer(resumer), _status(LogStatus::OK) {}
+            bool await_ready()
+            {
+                return _level < _logger->_limit_level;
+            }
+            bool await_suspend(std::coroutine_handle<> handle)
+            {
+                // 计数的初值1由本函数持有，排队的每条记录各占1，最后一个减到0的负责恢复协程
+                auto pending = std::make_shared<std::atomic<int>>(1);
+                Resumer resumer = _resumer;
+                std::function<void()> cb = [pending, resumer, handle]()
+                {
+                    if (--*pending == 0)
+                        resumer ? resumer(handle) : handle.resume();
+                };
+                _status = _logger->serialize(_level, _file, _line, _payload, PUSH_NOTIFY, &cb, pending.get());
+                // 返回true后协程可能已在其他线程恢复，之后不能再访问this
+                return --*pending != 0;
+            }
+            LogStatus await_resume()
+            {
+                return _level < _logger->_limit_level ? LogStatus::FILTERED : _status;
+            }
+
+        private:
+            Logger *_logger;
+            LogLevel::value _level;
+            const char *_file;
+            size_t _line;
+            std::string _payload;
+            Resumer _resumer;
+            LogStatus _status;
+        };
+        class FlushAwaiter
+        {
+        public:
+            FlushAwaiter(Logger *logger, const Resumer &resumer) : _logger(logger), _resumer(resumer) {}
+            bool await_ready()
+            {
+                return false;
+            }
+            bool await_suspend(std::coroutine_handle<> handle)
+            {
+                Resumer resumer = _resumer;
+                return !_logger->flushOrNotify([resumer, handle]()
+                                               { resumer ? resumer(handle) : handle.resume(); });
+            }
+            void await_resume()
+            {
+            }
+
+        private:
+            Logger *_logger;
+            Resumer _resumer;
+        };
+        // 消息在调用时格式化，挂起期间保存在等待对象中
+        LogAwaiter logAsync(LogLevel::value level, const char *file, size_t line, const std::string &fmt, ...)
+        {
+            std::string payload;
+            if (level >= _limit_level)
+            {
+                va_list ap;
+                va_start(ap, fmt);
+                const std::string *res = vformat(fmt.c_str(), ap);
+                va_end(ap);
+                if (res)
+                    payload = *res;
+            }
+            return LogAwaiter(this, level, file, line, std::move(payload), Resumer());
+        }
+        LogAwaiter logAsync(const Resumer &resumer, LogLevel::value level, const char *file, size_t line, const std::string &fmt, ...)
+        {
+            std::string payload;
+            if (level >= _limit_level)
+            {
+                va_list ap;
+                va_start(ap, fmt);
+                const std::string *res = vformat(fmt.c_str(), ap);
+                va_end(ap);
+                if (res)
+                    payload = *res;
+            }
+            return LogAwaiter(this, level, file, line, std::move(payload), resumer);
+        }
+        FlushAwaiter flushAsync(const Resumer &resumer = Resumer())
+        {
+            return FlushAwaiter(this, resumer);
+        }
+#endif
 
     protected:
-        void serialize(const LogLevel::value &level, const std::string file, const size_t line, const char *str)
+        // 格式化消息主体并写日志，不同模式的日志器可以重写(例如实时日志器在调用线程中不做格式化)
+        virtual LogStatus logv(LogLevel::value level, const char *file, size_t line, const char *fmt, va_list ap, PushMode mode)
+        {
+            const std::string *res = vformat(fmt, ap);
+            if (res == nullptr)
+                return LogStatus::FAILED;
+            return serialize(level, file, line, *res, mode);
+        }
+        // 按fmt格式化消息主体，结果保存在线程私有的字符串中，容量足够时不再申请内存；超过最大长度时截断
+        const std::string *vformat(const char *fmt, va_list ap)
+        {
+            static thread_local std::string payload;
+            char tmp[FORMAT_BUFFER_SIZE];
+            va_list cp;
+            va_copy(cp, ap);
+            int ret = vsnprintf(tmp, sizeof(tmp), fmt, cp);
+            va_end(cp);
+            if (ret < 0)
+            {
+                std::cout << "vsnprintf failed!\n";
+                return nullptr;
+            }
+            size_t limit = _max_message_size;
+            if (limit && (size_t)ret > limit)
+                return truncate(payload, tmp, ret, limit, fmt, ap);
+            if ((size_t)ret < sizeof(tmp))
+            {
+                payload.assign(tmp, ret);
+                return &payload;
+            }
+            payload.resize(ret);
+            vsnprintf(&payload[0], ret + 1, fmt, ap);
+            return &payload;
+        }
+        /*
+            消息主体共len字节，超过了limit：保留开头不超过limit字节(不拆开UTF-8字符)并加上截断标记
+            有溢出文件时完整内容先写入溢出文件，否则只格式化需要保留的部分
+        */
+        const std::string *truncate(std::string &payload, const char *tmp, size_t len, size_t limit, const char *fmt, va_list ap)
+        {
+            std::string id;
+            if (_spill && len >= FORMAT_BUFFER_SIZE)
+            {
+                // 完整内容只在这里临时存在，线程私有的字符串不会因此变大
+                std::string full(len, '\0');
+                vsnprintf(&full[0], len + 1, fmt, ap);
+                id = _spill->write(_logger_name, full.data(), len);
+                payload.assign(full, 0, limit + 1);
+            }
+            else if (len < FORMAT_BUFFER_SIZE)
+            {
+                if (_spill)
+                    id = _spill->write(_logger_name, tmp, len);
+                payload.assign(tmp, limit + 1);
+            }
+            else
+            {
+                // 多格式化一个字节，用于判断截断处是否位于一个字符的中间
+                payload.resize(limit + 1);
+                vsnprintf(&payload[0], limit + 2, fmt, ap);
+            }
+            size_t keep = limit;
+            while (keep > 0 && (payload[keep] & 0xC0) == 0x80)
+                --keep;
+            payload.resize(keep);
+            char mark[TRUNCATE_MARK_SIZE];
+            if (id.empty())
+                snprintf(mark, sizeof(mark), "...[truncated %zu bytes]", len - keep);
+            else
+                snprintf(mark, sizeof(mark), "...[spilled %zu bytes: %s]", len, id.c_str());
+            payload.append(mark);
+            return &payload;
+        }
+        // 所有日志器共用的层级关系锁，只在修改配置和层级时使用
+        static std::mutex &treeMutex()
+        {
+            static std::mutex mutex;
+            return mutex;
+        }
+        // 以下函数调用时需持有treeMutex
+        void inherit()
+        {
+            if (!_own_level)
+                propagateLevel(_parent->_limit_level);
+            if (!_own_formatter)
+                propagateFormatter(_parent->_base_formatter);
+            if (!_own_sinks)
+                propagateSinkOwner(_parent->_sink_owner);
+        }
+        void propagateLevel(LogLevel::value level)
+        {
+            _limit_level = level;
+            for (Logger *child : _children)
+            {
+                if (!child->_own_level)
+                    child->propagateLevel(level);
+            }
+        }
+        void propagateFormatter(const Formatter::ptr &formatter)
+        {
+            installFormatter(formatter);
+            for (Logger *child : _children)
+            {
+                if (!child->_own_formatter)
+                    child->propagateFormatter(formatter);
+            }
+        }
+        void propagateSinkOwner(Logger *owner)
+        {
+            _sink_owner = owner;
+            updatePlan();
+            for (Logger *child : _children)
+            {
+                if (!child->_own_sinks)
+                    child->propagateSinkOwner(owner);
+            }
+        }
+        void installFormatter(const Formatter::ptr &formatter)
+        {
+            _base_formatter = formatter;
+            updatePlan();
+        }
+        /*
+            按格式对输出日志的各落地方向分组：没有单独设置格式的落地方向使用日志器的格式，
+            格式相同的落地方向共用一个格式化器，每条日志按组各格式化一次
+        */
+        void updatePlan()
+        {
+            std::shared_ptr<FormatPlan> plan = std::make_shared<FormatPlan>();
+            Logger *owner = _sink_owner.load();
+            plan->owner = owner;
+            plan->groups.push_back({_base_formatter->bind(_logger_name), 0});
+            for (size_t i = 0; i < owner->_sink.size(); ++i)
+            {
+                uint64_t bit = 1ULL << std::min(i, (size_t)63);
+                Formatter::ptr formatter = owner->_sink[i]->getFormatter();
+                if (!formatter)
+                {
+                    plan->groups[0].sinks |= bit;
+                    continue;
+                }
+                size_t g = 1;
+                while (g < plan->groups.size() && plan->groups[g].formatter->pattern() != formatter->pattern())
+                    ++g;
+                if (g == plan->groups.size())
+                    plan->groups.push_back({formatter->bind(_logger_name), 0});
+                plan->groups[g].sinks |= bit;
+            }
+            std::unique_lock<std::mutex> lock(_formatter_mutex);
+            if (_current_plan)
+                _retired_plans.push_back(_current_plan);
+            _current_plan = plan;
+            _plan = plan.get();
+            // 先发布新方案再检查(均为顺序一致的操作)：此时没有正在使用方案的调用，之后开始的调用只会读到新方案
+            if (_plan_readers.load() == 0)
+                _retired_plans.clear();
+        }
+        // serialize期间持有，替换下来的方案在没有持有者时才释放
+        class PlanReader
+        {
+        public:
+            PlanReader(std::atomic<int> &readers) : _readers(readers) { ++_readers; }
+            ~PlanReader() { --_readers; }
+
+        private:
+            std::atomic<int> &_readers;
+        };
+        LogStatus serialize(const LogLevel::value &level, const char *file, const size_t line, const std::string &str,
+                            PushMode mode = PUSH_BLOCK, const std::function<void()> *notify = nullptr, std::atomic<int> *pending = nullptr)
         {
             // 构造logMsg对象
             logMsg msg(level, line, file, _logger_name, str);
-            // 进行格式化，得到格式化后的日志字符串
-            std::string s = _formatter->format(msg);
-            // 对日志进行落地
-            log(s.c_str(), s.size());
+            return serialize(msg, mode, notify, pending);
+        }
+        LogStatus serialize(const logMsg &msg, PushMode mode = PUSH_BLOCK, const std::function<void()> *notify = nullptr, std::atomic<int> *pending = nullptr)
+        {
+            LogLevel::value level = msg._level;
+            // 先按各落地方向的等级和过滤条件筛选，没有落地方向需要时不进行格式化
+            PlanReader reader(_plan_readers);
+            const FormatPlan *plan = _plan.load();
+            Logger *owner = plan->owner;
+            uint64_t sinks = owner->sinkMask(msg);
+            if (sinks == 0)
+                return LogStatus::FILTERED;
+            LogStatus status = LogStatus::OK;
+            // 直接格式化到线程私有的缓冲区中，消息主体以分段形式引用，避免中间字符串的拷贝
+            static thread_local Buffer buf(FORMAT_BUFFER_SIZE);
+            for (auto &group : plan->groups)
+            {
+                LogRecord record = {0, msg._ctime, level, &_logger_name, sinks & group.sinks, &owner->_logger_name};
+                if (record._sinks == 0)
+                    continue;
+                buf.reset();
+                struct iovec iov[FORMAT_MAX_IOV];
+                int iovcnt = group.formatter->format(buf, msg, iov, FORMAT_MAX_IOV);
+                for (int i = 0; i < iovcnt; ++i)
+                    record._len += iov[i].iov_len;
+                // 对日志进行落地(没有落地方向时交给祖先日志器)，只交给本组的落地方向
+                if (mode == PUSH_BLOCK)
+                    owner->log(iov, iovcnt, record);
+                else if (mode == PUSH_TRY && !owner->tryPush(iov, iovcnt, record))
+                    status = LogStatus::FULL;
+                else if (mode == PUSH_NOTIFY)
+                {
+                    ++*pending;
+                    if (owner->pushOrNotify(iov, iovcnt, record, *notify))
+                        --*pending;
+                }
+            }
+            if (mode == PUSH_BLOCK && level >= _flush_level)
+                owner->flush(DEFAULT_FLUSH_TIMEOUT);
+            return status;
+        }
+        // 不等待的写入，无法立即写入时返回false；同步日志器总是直接写入
+        virtual bool tryPush(const struct iovec *iov, int iovcnt, const LogRecord &record)
+        {
+            log(iov, iovcnt, record);
+            return true;
+        }
+        // 无法立即写入时排队并返回false，写入后调用cb
+        virtual bool pushOrNotify(const struct iovec *iov, int iovcnt, const LogRecord &record, const std::function<void()> &)
+        {
+            log(iov, iovcnt, record);
+            return true;
+        }
+        // 已写入的数据已经落地时返回true，否则返回false并在落地后调用cb
+        virtual bool flushOrNotify(const std::function<void()> &cb)
+        {
+            Logger *owner = _sink_owner.load();
+            if (owner != this)
+                return owner->flushOrNotify(cb);
+            flush();
+            return true;
+        }
+        // 接收msg的落地方向，第63位由第63个及之后的落地方向共用
+        uint64_t sinkMask(const logMsg &msg)
+        {
+            uint64_t mask = 0;
+            for (size_t i = 0; i < _sink.size(); ++i)
+            {
+                if (_sink[i]->accept(msg))
+                    mask |= 1ULL << std::min(i, (size_t)63);
+            }
+            return mask;
+        }
+        static bool hasSink(uint64_t mask, size_t idx)
+        {
+            return mask & (1ULL << std::min(idx, (size_t)63));
         }
         // 抽象接口完成实际落地输出，不同的日志器有不同的落地方式
-        virtual void log(const char *data, const int &len) = 0;
+        virtual void log(const struct iovec *iov, int iovcnt, const LogRecord &record) = 0;
 
     protected:
-        std::mutex _mutex;
         std::atomic<LogLevel::value> _limit_level;
+        std::atomic<LogLevel::value> _flush_level;
+        std::atomic<size_t> _max_message_size; // 消息主体的最大字节数，0表示不限制
+        SpillFile::ptr _spill;                 // 超长消息的溢出文件，为空时只截断
         std::string _logger_name;
-        Formatter::ptr _formatter;
+        struct FormatGroup
+        {
+            Formatter::ptr formatter; // 绑定了本日志器名称的格式化器
+            uint64_t sinks;           // 使用该格式的落地方向
+        };
+        struct FormatPlan
+        {
+            Logger *owner; // 输出日志的日志器，sinks中的位对应它的落地方向
+            std::vector<FormatGroup> groups;
+        };
+        std::atomic<FormatPlan *> _plan;            // 当前使用的格式化方案
+        std::atomic<int> _plan_readers;             // 正在使用_plan的serialize调用数
+        std::mutex _formatter_mutex;
+        std::shared_ptr<FormatPlan> _current_plan;
+        std::vector<std::shared_ptr<FormatPlan>> _retired_plans; // 替换下来、可能仍在被其他线程使用的方案，下次替换时没有使用者则释放
         std::vector<LogSink::ptr> _sink;
+        Formatter::ptr _base_formatter;          // 未绑定名称的格式化器，供子日志器继承
+        bool _own_level;                         // 以下各项为false时继承自父日志器
+        bool _own_formatter;
+        bool _own_sinks;
+        std::atomic<Logger *> _sink_owner;       // 实际输出日志的日志器(自身或祖先)
+        ptr _parent;
+        std::vector<Logger *> _children;         // 子日志器持有父日志器，析构时从父日志器中移除
     };
 
+    /*
+        同步日志器：在调用线程中格式化(线程私有的缓冲区)并直接写入各落地方向，不持有日志器级别的锁，
+        线程安全的落地方向(例如FileSink)可以被多个线程同时写入，其余落地方向按各自的锁串行写入
+    */
     class SyncLogger : public Logger
     {
     public:
@@ -152,41 +657,253 @@ namespace mylog
             : Logger(level, logger_name, formatter, sinks) {}
 
     protected:
-        void log(const char *data, const int &len)
+        void log(const struct iovec *iov, int iovcnt, const LogRecord &record)
         {
-            std::unique_lock<std::mutex> lock(_mutex);
-            if (_sink.empty())
-                return;
+            LogBatch batch = {iov, iovcnt, &record, 1};
+            for (size_t i = 0; i < _sink.size(); ++i)
+            {
+                if (!hasSink(record._sinks, i))
+                    continue;
+                if (_sink[i]->threadSafe())
+                {
+                    _sink[i]->log(batch);
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock(_sink[i]->mutex());
+                _sink[i]->log(batch);
+            }
+        }
+        bool flush(int timeout_ms = -1)
+        {
+            Logger *owner = _sink_owner.load();
+            if (owner != this)
+                return owner->flush(timeout_ms);
             for (auto &sink : _sink)
-                sink->log(data, len);
+            {
+                std::unique_lock<std::mutex> lock(sink->mutex());
+                sink->flush();
+            }
+            return true;
         }
     };
 
     class AsyncLogger : public Logger
     {
     public:
-        AsyncLogger(const std::string &logger_name, const LogLevel::value &level, Formatter::ptr &formatter, std::vector<LogSink::ptr> &sinks, AsyncType looper_type)
-            : Logger(level, logger_name, formatter, sinks), _looper(std::make_shared<AsyncLooper>(std::bind(&AsyncLogger::realLog, this, std::placeholders::_1), looper_type)) {}
-        void log(const char *data, const int &len) // 将数据写入缓冲区
+        AsyncLogger(const std::string &logger_name, const LogLevel::value &level, Formatter::ptr &formatter, std::vector<LogSink::ptr> &sinks, AsyncType looper_type,
+                    size_t buffer_size = DEFAULT_BUFFER_SIZE, const LooperOptions &options = LooperOptions(), const Allocator::ptr &alloc = Allocator::getDefault())
+            : Logger(level, logger_name, formatter, sinks),
+              _looper(std::make_shared<AsyncLooper>(std::bind(static_cast<void (AsyncLogger::*)(Buffer &)>(&AsyncLogger::realLog), this, std::placeholders::_1),
+                                                    looper_type, buffer_size, options, alloc)) {}
+        // 使用共享线程池中的工作线程，不单独创建线程和缓冲区
+        AsyncLogger(const std::string &logger_name, const LogLevel::value &level, Formatter::ptr &formatter, std::vector<LogSink::ptr> &sinks, const LooperPool::ptr &pool)
+            : Logger(level, logger_name, formatter, sinks), _pool(pool)
+        {
+            _looper = _pool->attach(&_logger_name, std::bind(static_cast<void (AsyncLogger::*)(const char *, size_t, const LogRecord *, size_t)>(&AsyncLogger::realLog),
+                                                             this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+        }
+        // 先处理完剩余的数据，此后不再回调realLog
+        ~AsyncLogger()
+        {
+            if (_pool)
+                _pool->detach(&_logger_name, _looper);
+            else
+                _looper->stop();
+        }
+        void log(const struct iovec *iov, int iovcnt, const LogRecord &record) // 将数据写入缓冲区
         {
-            _looper->push(data, len);
+            _looper->push(iov, iovcnt, record);
+        }
+        bool tryPush(const struct iovec *iov, int iovcnt, const LogRecord &record)
+        {
+            return _looper->tryPush(iov, iovcnt, record);
+        }
+        bool pushOrNotify(const struct iovec *iov, int iovcnt, const LogRecord &record, const std::function<void()> &cb)
+        {
+            return _looper->pushOrNotify(iov, iovcnt, record, cb);
+        }
+        bool flushOrNotify(const std::function<void()> &cb)
+        {
+            return _looper->flushOrNotify(cb);
+        }
+        // 使用共享线程池时会一并等待同一工作线程上其他日志器的数据
+        bool flush(int timeout_ms = -1)
+        {
+            return _looper->flush(timeout_ms);
         }
         void realLog(Buffer &buf) // 将数据写入到文件中
+        {
+            realLog(buf.begin(), buf.readAbleSize(), buf.records(), buf.recordCount());
+        }
+        void realLog(const char *data, size_t len, const LogRecord *records, size_t count)
         {
             if (_sink.empty())
                 return;
+            struct iovec iov = {const_cast<char *>(data), len};
+            LogBatch whole = {&iov, 1, records, count};
+            // 所有记录都需要的落地方向直接使用整批数据
+            uint64_t all = ~0ULL;
+            for (size_t i = 0; i < count; ++i)
+                all &= records[i]._sinks;
+            // 各落地方向同时写入(支持异步写入的落地方向可以并行进行)，全部完成后再刷新
+            Completion completion(_sink.size());
+            for (size_t i = 0; i < _sink.size(); ++i)
+            {
+                LogBatch batch = whole;
+                if (!hasSink(all, i) && !select(i, data, records, count, batch))
+                {
+                    completion.done();
+                    continue;
+                }
+                _sink[i]->logAsync(batch, [&completion]()
+                                   { completion.done(); });
+            }
+            completion.wait();
             for (auto &sink : _sink)
-                sink->log(buf.begin(), buf.readAbleSize());
+                sink->flush(); // 每批数据处理完就刷新，flush()返回时数据已经落地
         }
 
     private:
+        struct Completion
+        {
+            std::mutex mutex;
+            std::condition_variable cond;
+            size_t left;
+            Completion(size_t count) : left(count) {}
+            void done()
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (--left == 0)
+                    cond.notify_all();
+            }
+            void wait()
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [this]()
+                          { return left == 0; });
+            }
+        };
+        // 第idx个落地方向接收的记录组成的一批数据，相邻的记录合并为一段，没有记录时返回false
+        bool select(size_t idx, const char *data, const LogRecord *records, size_t count, LogBatch &batch)
+        {
+            if (_selections.size() < _sink.size())
+                _selections.resize(_sink.size());
+            auto &iovs = _selections[idx].first;
+            auto &selected = _selections[idx].second;
+            iovs.clear();
+            selected.clear();
+            bool last = false;
+            for (size_t i = 0; i < count; data += records[i]._len, ++i)
+            {
+                bool cur = hasSink(records[i]._sinks, idx);
+                if (cur && last)
+                    iovs.back().iov_len += records[i]._len;
+                else if (cur)
+                    iovs.push_back({const_cast<char *>(data), records[i]._len});
+                if (cur)
+                    selected.push_back(records[i]);
+                last = cur;
+            }
+            batch = {iovs.data(), (int)iovs.size(), selected.data(), selected.size()};
+            return !selected.empty();
+        }
+
+    private:
+        // 各落地方向筛选出的数据，只在工作线程中使用，异步写入完成前保持有效；
+        // 在_looper之前声明，析构时工作线程处理剩余数据仍会用到
+        std::vector<std::pair<std::vector<struct iovec>, std::vector<LogRecord>>> _selections;
+        LooperPool::ptr _pool;
         AsyncLooper::ptr _looper;
     };
 
+    /*
+        实时日志器：写日志的线程只把格式串展开到预先分配的槽中并记录TSC计数(由后台线程换算为时间)，
+        不加锁、不申请内存、不进行系统调用，没有空闲槽时立即丢弃并返回LogStatus::FULL；
+        按格式器排版以及写入落地方向都在后台线程中进行
+        诊断上下文(MDC)拷贝到槽中，超过槽容量的一半时不记录；消息主体超过槽的剩余容量时截断
+    */
+    class RealtimeLogger : public SyncLogger
+    {
+    public:
+        RealtimeLogger(const std::string &logger_name, const LogLevel::value &level, Formatter::ptr &formatter, std::vector<LogSink::ptr> &sinks,
+                       size_t slot_count = DEFAULT_RT_SLOT_COUNT, size_t slot_size = DEFAULT_RT_SLOT_SIZE,
+                       const LooperOptions &options = LooperOptions(), const Allocator::ptr &alloc = Allocator::getDefault())
+            : SyncLogger(logger_name, level, formatter, sinks)
+        {
+            util::TscClock::calibrate();
+            _looper = std::make_shared<RealtimeLooper>(std::bind(&RealtimeLogger::realLog, this, std::placeholders::_1, std::placeholders::_2),
+                                                       slot_count, slot_size, options, alloc);
+        }
+        ~RealtimeLogger()
+        {
+            _looper->stop();
+        }
+        // 没有空闲槽而丢弃的日志条数
+        size_t dropped()
+        {
+            return _looper->dropped();
+        }
+        bool flush(int timeout_ms = -1)
+        {
+            // 后台线程中按等级触发的刷新不能等待自己
+            if (std::this_thread::get_id() != _looper->threadId() && !_looper->flush(timeout_ms))
+                return false;
+            return SyncLogger::flush(timeout_ms);
+        }
+
+    protected:
+        LogStatus logv(LogLevel::value level, const char *file, size_t line, const char *fmt, va_list ap, PushMode)
+        {
+            uint64_t pos;
+            RtRecord *rec = _looper->reserve(pos);
+            if (rec == nullptr)
+                return LogStatus::FULL;
+            char *data = RealtimeLooper::payload(rec);
+            size_t cap = _looper->payloadCapacity();
+            // 上下文已经渲染好，只需拷贝
+            const MdcView &mdc = MDC::view();
+            size_t mdc_size = mdc.count * sizeof(MdcEntry) + mdc.len;
+            rec->mdc_count = 0;
+            rec->mdc_len = 0;
+            if (mdc_size && mdc_size <= cap / 2)
+            {
+                memcpy(data, mdc.entries, mdc.count * sizeof(MdcEntry));
+                memcpy(data + mdc.count * sizeof(MdcEntry), mdc.data, mdc.len);
+                rec->mdc_count = mdc.count;
+                rec->mdc_len = mdc.len;
+                data += mdc_size;
+                cap -= mdc_size;
+            }
+            int ret = vsnprintf(data, cap, fmt, ap);
+            rec->len = ret < 0 ? 0 : std::min((size_t)ret, cap - 1);
+            rec->ticks = util::TscClock::ticks();
+            rec->level = level;
+            rec->line = line;
+            rec->file = file;
+            rec->tid = util::Thread::current();
+            _looper->commit(rec, pos);
+            return ret < 0 ? LogStatus::FAILED : LogStatus::OK;
+        }
+        void realLog(const RtRecord &rec, const char *payload)
+        {
+            static thread_local std::string str;
+            const MdcEntry *entries = reinterpret_cast<const MdcEntry *>(payload);
+            MdcView mdc = {payload + rec.mdc_count * sizeof(MdcEntry), rec.mdc_len, entries, rec.mdc_count};
+            payload = mdc.data + mdc.len;
+            str.assign(payload, rec.len);
+            logMsg msg(rec.level, rec.line, rec.file, _logger_name, str, util::TscClock::toNs(rec.ticks), &rec.tid, &mdc);
+            serialize(msg);
+        }
+
+    private:
+        RealtimeLooper::ptr _looper;
+    };
+
     enum class LoggerType
     {
         LOGGER_SYNC,
-        LOGGER_ASYNC
+        LOGGER_ASYNC,
+        LOGGER_REALTIME // 见RealtimeLogger
     };
 
     class LoggerBuilder
@@ -194,7 +911,13 @@ namespace mylog
     public:
         LoggerBuilder() : _logger_type(LoggerType::LOGGER_SYNC),
                           _limit_level(LogLevel::value::DEBUG),
-                          _looper_type(AsyncType::ASYNC_SAFE)
+                          _looper_type(AsyncType::ASYNC_SAFE),
+                          _buffer_size(DEFAULT_BUFFER_SIZE),
+                          _flush_level(LogLevel::value::OFF),
+                          _rt_slot_count(DEFAULT_RT_SLOT_COUNT),
+                          _rt_slot_size(DEFAULT_RT_SLOT_SIZE),
+                          _max_message_size(0),
+                          _level_set(false)
         {
         }
         void buildLoggerType(LoggerType logger_type)
@@ -205,6 +928,11 @@ namespace mylog
         {
             _looper_type = AsyncType::ASYNC_UNSAFE;
         }
+        // 异步日志器缓冲区的初始大小
+        void buildBufferSize(size_t buffer_size)
+        {
+            _buffer_size = buffer_size;
+        }
         void buildLoggername(const std::string &logger_name)
         {
             _logger_name = logger_name;
@@ -212,6 +940,7 @@ namespace mylog
         void buildLoggerLevel(LogLevel::value limit_level)
         {
             _limit_level = limit_level;
+            _level_set = true;
         }
         void buildFormatter(const std::string &pattern)
         {
@@ -223,15 +952,129 @@ namespace mylog
             LogSink::ptr psink = SinkFactory::create<SinkType>(std::forward<Args>(args)...);
             _sinks.push_back(psink);
         }
+        void buildSink(const LogSink::ptr &psink)
+        {
+            _sinks.push_back(psink);
+        }
+        // 异步线程只在指定的CPU上运行，缓冲区也会分配在这些CPU所在的NUMA节点上
+        void buildLooperAffinity(const std::vector<int> &cpus)
+        {
+            _looper_options.cpus = cpus;
+        }
+        // 异步线程的调度策略(SCHED_FIFO/SCHED_RR需要相应权限)
+        void buildLooperPriority(int policy, int priority)
+        {
+            _looper_options.policy = policy;
+            _looper_options.priority = priority;
+        }
+        void buildLooperNice(int nice)
+        {
+            _looper_options.nice = nice;
+        }
+        // 异步线程名，默认为"mylog-"加日志器名
+        void buildLooperName(const std::string &name)
+        {
+            _looper_options.name = name;
+        }
+        // 异步日志器缓冲区的分配器(例如大页、内存块回收池)，默认为Allocator::getDefault()
+        void buildAllocator(const Allocator::ptr &alloc)
+        {
+            _alloc = alloc;
+        }
+        // 异步日志器使用共享线程池，此时缓冲区大小和异步线程的参数由线程池决定
+        void buildLooperPool(const LooperPool::ptr &pool)
+        {
+            _looper_pool = pool;
+        }
+        // 实时日志器的槽数(取整为2的幂)和每个槽的字节数(包含元信息，消息主体超出时截断)
+        void buildRealtimeSlots(size_t count, size_t size)
+        {
+            _rt_slot_count = count;
+            _rt_slot_size = size;
+        }
+        // 消息主体的最大字节数(0表示不限制)，spill_file不为空时超长消息的完整内容写入该文件，见Logger::setMaxMessageSize
+        void buildMaxMessageSize(size_t size, const std::string &spill_file = "")
+        {
+            _max_message_size = size;
+            _spill_file = spill_file;
+        }
+        // 日志等级不低于level时，写入后立即刷新(异步日志器会等待数据落地)
+        void buildFlushLevel(LogLevel::value level)
+        {
+            _flush_level = level;
+        }
         virtual Logger::ptr build() = 0;
 
+    protected:
+        /*
+            按已设置的参数创建日志器，各种建造者共用
+            inherit为true时没有设置的等级、格式和落地方向留待从父日志器继承；
+            没有落地方向的日志器总是创建为同步日志器，日志交给祖先输出，不需要自己的异步线程
+        */
+        Logger::ptr create(bool inherit = false)
+        {
+            assert(!_logger_name.empty()); // 必须要有日志器名
+            bool inherit_formatter = inherit && _formatter.get() == nullptr;
+            if (_formatter.get() == nullptr)
+            {
+                _formatter = std::make_shared<Formatter>();
+            }
+            if (_sinks.empty() && inherit)
+            {
+                _logger_type = LoggerType::LOGGER_SYNC;
+            }
+            else if (_sinks.empty())
+            {
+                buildSink<StdoutSink>();
+            }
+            Logger::ptr logger;
+            if (_logger_type == LoggerType::LOGGER_ASYNC && _looper_pool)
+            {
+                logger = std::make_shared<AsyncLogger>(_logger_name, _limit_level, _formatter, _sinks, _looper_pool);
+            }
+            else if (_logger_type == LoggerType::LOGGER_ASYNC)
+            {
+                if (_looper_options.name.empty())
+                    _looper_options.name = "mylog-" + _logger_name;
+                logger = std::make_shared<AsyncLogger>(_logger_name, _limit_level, _formatter, _sinks, _looper_type, _buffer_size, _looper_options,
+                                                       _alloc ? _alloc : Allocator::getDefault());
+            }
+            else if (_logger_type == LoggerType::LOGGER_REALTIME)
+            {
+                if (_looper_options.name.empty())
+                    _looper_options.name = "mylog-" + _logger_name;
+                logger = std::make_shared<RealtimeLogger>(_logger_name, _limit_level, _formatter, _sinks, _rt_slot_count, _rt_slot_size, _looper_options,
+                                                          _alloc ? _alloc : Allocator::getDefault());
+            }
+            else
+            {
+                logger = std::make_shared<SyncLogger>(_logger_name, _limit_level, _formatter, _sinks);
+            }
+            logger->setFlushLevel(_flush_level);
+            logger->setMaxMessageSize(_max_message_size);
+            if (_spill_file.size())
+                logger->setSpillFile(std::make_shared<SpillFile>(_spill_file));
+            logger->setInherited(inherit && !_level_set, inherit_formatter);
+            return logger;
+        }
+
     protected:
         AsyncType _looper_type;
+        size_t _buffer_size;
+        LooperOptions _looper_options;
+        LooperPool::ptr _looper_pool;
+        Allocator::ptr _alloc;
         LoggerType _logger_type;
         std::string _logger_name;
         std::atomic<LogLevel::value> _limit_level;
+        LogLevel::value _flush_level;
+        size_t _rt_slot_count;
+        size_t _rt_slot_size;
+        size_t _max_message_size;
+        std::string _spill_file;
         Formatter::ptr _formatter;
         std::vector<LogSink::ptr> _sinks;
+        bool _level_set; // 是否设置过等级
     };
 
     class LocalLoggerBuilder : public LoggerBuilder
@@ -239,20 +1082,7 @@ namespace mylog
     public:
         Logger::ptr build() override
         {
-            assert(!_logger_name.empty()); // 必须要有日志器名
-            if (_formatter.get() == nullptr)
-            {
-                _formatter = std::make_shared<Formatter>();
-            }
-            if (_sinks.empty())
-            {
-                buildSink<StdoutSink>();
-            }
-            if (_logger_type == LoggerType::LOGGER_ASYNC)
-            {
-                return std::make_shared<AsyncLogger>(_logger_name, _limit_level, _formatter, _sinks, _looper_type);
-            }
-            return std::make_shared<SyncLogger>(_logger_name, _limit_level, _formatter, _sinks);
+            return create();
         }
     };
 
@@ -264,12 +1094,22 @@ namespace mylog
             static LoggerManager eton;
             return eton;
         }
+        // 登记日志器并连接到层级中：父日志器为最近的已存在的祖先(默认为root)，
+        // 原先挂在该祖先下、名称以本日志器名加'.'开头的日志器改为挂在本日志器下
         void addLogger(Logger::ptr &logger)
         {
-            if (hasLogger(logger->getLoggerName()))
-                return;
             std::unique_lock<std::mutex> lock(_mutex);
-            _logger.insert(std::make_pair(logger->getLoggerName(), logger));
+            const std::string &name = logger->getLoggerName();
+            if (!_logger.insert(std::make_pair(name, logger)).second)
+                return;
+            Logger::ptr parent = findParent(name);
+            std::string prefix = name + ".";
+            for (Logger *child : parent->getChildren())
+            {
+                if (child->getLoggerName().compare(0, prefix.size(), prefix) == 0)
+                    _logger[child->getLoggerName()]->setParent(logger);
+            }
+            logger->setParent(parent);
         }
         bool hasLogger(const std::string &name)
         {
@@ -291,6 +1131,26 @@ namespace mylog
         {
             return _root_logger;
         }
+        // 获取日志器，不存在时创建一个各项配置都继承自祖先的同步日志器
+        Logger::ptr getOrCreateLogger(const std::string &name);
+        // 在总时长timeout_ms内刷新所有日志器，用于进程退出前尽量保存所有日志，全部完成返回true
+        bool shutdown(int timeout_ms)
+        {
+            std::vector<Logger::ptr> loggers;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                for (auto &it : _logger)
+                    loggers.push_back(it.second);
+            }
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+            bool ret = true;
+            for (auto &logger : loggers)
+            {
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+                ret = logger->flush(std::max(0, (int)left.count())) && ret;
+            }
+            return ret;
+        }
 
     private:
         LoggerManager()
@@ -301,6 +1161,19 @@ namespace mylog
             _logger.insert(std::make_pair("root", _root_logger));
         }
 
+        // 最近的已存在的祖先，调用时需持有_mutex
+        Logger::ptr findParent(const std::string &name)
+        {
+            size_t pos = name.size();
+            while ((pos = name.find_last_of('.', pos - 1)) != std::string::npos && pos > 0)
+            {
+                auto it = _logger.find(name.substr(0, pos));
+                if (it != _logger.end())
+                    return it->second;
+            }
+            return _root_logger;
+        }
+
     private:
         std::mutex _mutex;
         Logger::ptr _root_logger; // 默认日志器
@@ -312,28 +1185,22 @@ namespace mylog
     public:
         Logger::ptr build() override
         {
-            assert(!_logger_name.empty()); // 必须要有日志器名
-            if (_formatter.get() == nullptr)
-            {
-                _formatter = std::make_shared<Formatter>();
-            }
-            if (_sinks.empty())
-            {
-                buildSink<StdoutSink>();
-            }
-            Logger::ptr logger;
-            if (_logger_type == LoggerType::LOGGER_ASYNC)
-            {
-                logger = std::make_shared<AsyncLogger>(_logger_name, _limit_level, _formatter, _sinks, _looper_type);
-            }
-            else
-            {
-                logger = std::make_shared<SyncLogger>(_logger_name, _limit_level, _formatter, _sinks);
-            }
+            Logger::ptr logger = create(true);
             LoggerManager::getInstance().addLogger(logger);
             return logger;
         }
     };
+
+    inline Logger::ptr LoggerManager::getOrCreateLogger(const std::string &name)
+    {
+        Logger::ptr logger = getLogger(name);
+        if (logger)
+            return logger;
+        GlobalLoggerBuilder builder;
+        builder.buildLoggername(name);
+        builder.build();
+        return getLogger(name); // 并发创建时以先登记的为准
+    }
 }
 
 #endif
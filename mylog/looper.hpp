@@ -7,6 +7,19 @@
 #include <atomic>
 #include "thread"
 #include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <deque>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <cstring>
+#include <new>
+#include <algorithm>
 
 namespace mylog
 {
@@ -15,13 +28,30 @@ namespace mylog
         ASYNC_SAFE,
         ASYNC_UNSAFE
     };
+    // 异步工作线程的调度参数
+    struct LooperOptions
+    {
+        std::vector<int> cpus;    // 绑定的CPU，为空表示不限制
+        int policy = SCHED_OTHER; // 调度策略：SCHED_OTHER/SCHED_FIFO/SCHED_RR
+        int priority = 0;         // SCHED_FIFO/SCHED_RR下的静态优先级
+        int nice = 0;             // SCHED_OTHER下的nice值
+        std::string name;         // 线程名，最多15个字符
+    };
     using Functor = std::function<void(Buffer &)>;
     class AsyncLooper
     {
     public:
         using ptr = std::shared_ptr<AsyncLooper>;
-        AsyncLooper(const Functor &cb, AsyncType looper_type = AsyncType::ASYNC_SAFE) : _stop(false), _thread(std::thread(&AsyncLooper::threadEntry, this)),
-                                                                                        _callback(cb), _looper_type(looper_type) {}
+        AsyncLooper(const Functor &cb, AsyncType looper_type = AsyncType::ASYNC_SAFE, size_t buffer_size = DEFAULT_BUFFER_SIZE,
+                    const LooperOptions &options = LooperOptions(), const Allocator::ptr &alloc = Allocator::getDefault())
+            : _callback(cb), _looper_type(looper_type), _options(options), _buffer_size(buffer_size), _alloc(alloc), _stop(false), _ready(false), _exited(false),
+              _pro_buf(0), _con_buf(0), _push_seq(0), _swap_seq(0), _done_seq(0), _thread(std::thread(&AsyncLooper::threadEntry, this))
+        {
+            // 缓冲区由工作线程在设置好CPU亲和性之后分配，等待其完成
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cond_flush.wait(lock, [&]()
+                             { return _ready; });
+        }
         ~AsyncLooper()
         {
             stop();
@@ -33,57 +63,570 @@ namespace mylog
             // 添加条件变量确保满足写入需求(只有在安全状态下才需要进行生产者的条件变量判断)
             if (_looper_type == AsyncType::ASYNC_SAFE)
                 _cond_pro.wait(lock, [&]()
-                               { return _pro_buf.writeAbleSize() >= len; });
+                               { return _stop || fits(len); });
             // 满足需求后将数据写入缓冲区
             _pro_buf.push(data, len);
-            // 随机唤醒一个消费者进行数据处理
-            _cond_pro.notify_one();
+            // 唤醒消费者进行数据处理
+            pushed();
+        }
+        // 一条日志的分段数据整体写入缓冲区，各段只拷贝一次
+        void push(const struct iovec *iov, int iovcnt, const LogRecord &record)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (_looper_type == AsyncType::ASYNC_SAFE)
+                _cond_pro.wait(lock, [&]()
+                               { return _stop || fits(record._len); });
+            _pro_buf.push(iov, iovcnt, record);
+            pushed();
+        }
+        // 不等待的写入：安全模式下缓冲区空间不足(或已有排队的日志)时直接返回false
+        bool tryPush(const struct iovec *iov, int iovcnt, const LogRecord &record)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (_looper_type == AsyncType::ASYNC_SAFE && !_stop && (!_waiters.empty() || !fits(record._len)))
+                return false;
+            _pro_buf.push(iov, iovcnt, record);
+            pushed();
+            return true;
+        }
+        /*
+            不阻塞调用线程的写入：有空间时直接写入并返回true；否则拷贝一份排队，返回false，
+            等工作线程交换缓冲区腾出空间后按排队顺序写入，再在工作线程中调用cb
+        */
+        bool pushOrNotify(const struct iovec *iov, int iovcnt, const LogRecord &record, const std::function<void()> &cb)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (_looper_type == AsyncType::ASYNC_UNSAFE || _stop || (_waiters.empty() && fits(record._len)))
+            {
+                _pro_buf.push(iov, iovcnt, record);
+                pushed();
+                return true;
+            }
+            Waiter waiter;
+            for (int i = 0; i < iovcnt; ++i)
+                waiter.data.append(static_cast<const char *>(iov[i].iov_base), iov[i].iov_len);
+            waiter.record = record;
+            waiter.cb = cb;
+            _waiters.push_back(std::move(waiter));
+            _cond_con.notify_one();
+            return false;
+        }
+        // 调用之前写入的数据已经处理完毕时返回true；否则返回false，处理完毕后在工作线程中调用cb
+        bool flushOrNotify(const std::function<void()> &cb)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (_done_seq >= _push_seq || _exited)
+                return true;
+            _flush_waiters.push_back(std::make_pair(_push_seq, cb));
+            return false;
+        }
+        // 等待调用之前写入的数据全部处理完毕，timeout_ms小于0时一直等待，超时返回false
+        bool flush(int timeout_ms = -1)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            uint64_t target = _push_seq;
+            auto done = [&]()
+            { return _done_seq >= target || _exited; };
+            if (timeout_ms < 0)
+            {
+                _cond_flush.wait(lock, done);
+                return true;
+            }
+            return _cond_flush.wait_for(lock, std::chrono::milliseconds(timeout_ms), done);
         }
         void stop()
         {
-            _stop = true;
-            _cond_con.notify_all(); // 唤醒所有线程，防止阻塞
-            // 这里可能要加唤醒生产者线程的操作
-            _thread.join();
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _stop = true;
+            }
+            // 唤醒所有线程，防止阻塞：消费者处理完剩余数据后退出，等待空间的生产者直接写入
+            _cond_con.notify_all();
+            _cond_pro.notify_all();
+            if (_thread.joinable())
+                _thread.join();
+        }
+
+        // 设置当前(工作)线程的名称、CPU亲和性和调度参数，失败时给出提示后继续运行
+        static void applyOptions(const LooperOptions &options)
+        {
+            if (!options.name.empty())
+                pthread_setname_np(pthread_self(), options.name.substr(0, 15).c_str());
+            if (!options.cpus.empty())
+            {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                for (int cpu : options.cpus)
+                    CPU_SET(cpu, &set);
+                if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+                    std::cout << "异步线程绑定CPU失败" << std::endl;
+            }
+            if (options.policy != SCHED_OTHER)
+            {
+                struct sched_param param;
+                param.sched_priority = options.priority;
+                if (pthread_setschedparam(pthread_self(), options.policy, &param) != 0)
+                    std::cout << "异步线程设置调度策略失败" << std::endl;
+            }
+            else if (options.nice != 0)
+            {
+                // Linux下nice值是按线程生效的
+                if (setpriority(PRIO_PROCESS, util::Thread::current().tid, options.nice) != 0)
+                    std::cout << "异步线程设置nice值失败" << std::endl;
+            }
         }
 
     private:
         void threadEntry() // 线程函数入口
         {
+            applyOptions(_options);
+            {
+                // 在工作线程中分配缓冲区并逐页写入：按首次访问原则，内存页分配在工作线程所在的NUMA节点上，
+                // 同时避免运行中第一次写入时的缺页开销
+                Buffer pro_buf(_buffer_size, _alloc), con_buf(_buffer_size, _alloc);
+                pro_buf.prefault();
+                con_buf.prefault();
+                // 分配器可能向上取整(例如按大页)，以实际容量判断缓冲区是否因超长日志扩容过
+                _buffer_size = con_buf.capacity();
+                std::unique_lock<std::mutex> lock(_mutex);
+                _pro_buf.swap(pro_buf);
+                _con_buf.swap(con_buf);
+                _ready = true;
+            }
+            _cond_flush.notify_all();
+            std::vector<std::function<void()>> notify;
             while (1)
             {
                 {
                     std::unique_lock<std::mutex> lock(_mutex);
                     // 根据条件变量判断是否满足消费条件
-                    if (_stop && _pro_buf.empty())
-                        break;
                     _cond_con.wait(lock, [&]()
-                                   { return _stop || !_pro_buf.empty(); });
+                                   { return _stop || !_pro_buf.empty() || !_waiters.empty(); });
+                    admitWaiters(notify);
+                    // 只有在停止且数据全部处理完毕时才退出
+                    if (_pro_buf.empty())
+                    {
+                        _exited = true;
+                        for (auto &waiter : _flush_waiters)
+                            notify.push_back(std::move(waiter.second));
+                        _flush_waiters.clear();
+                        lock.unlock();
+                        _cond_flush.notify_all();
+                        runNotify(notify);
+                        break;
+                    }
                     // 交换缓冲区
                     _con_buf.swap(_pro_buf);
+                    _swap_seq = _push_seq;
+                    // 腾出空间后先写入排队的日志
+                    admitWaiters(notify);
                     // 唤醒生产者线程(只有在安全状态下才需要进行条件变量的判断和唤醒)
                     if (_looper_type == AsyncType::ASYNC_SAFE)
                         _cond_pro.notify_all();
                 }
+                runNotify(notify);
                 // 对数据进行处理
                 _callback(_con_buf);
-                // 清空缓冲区
+                // 清空缓冲区，安全模式下因超长日志扩容的缓冲区恢复原来的大小
                 _con_buf.reset();
+                if (_looper_type == AsyncType::ASYNC_SAFE && _con_buf.shrink(_buffer_size))
+                    _con_buf.prefault();
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _done_seq = _swap_seq;
+                    for (size_t i = 0; i < _flush_waiters.size();)
+                    {
+                        if (_flush_waiters[i].first > _done_seq)
+                        {
+                            ++i;
+                            continue;
+                        }
+                        notify.push_back(std::move(_flush_waiters[i].second));
+                        _flush_waiters.erase(_flush_waiters.begin() + i);
+                    }
+                }
+                _cond_flush.notify_all();
+                runNotify(notify);
+            }
+        }
+        /*
+            写入生产缓冲区后调用，调用时需持有锁：通知工作线程处理；
+            工作线程已经退出(与stop()同时或之后的写入)时在调用线程中直接处理，保证不丢失
+        */
+        void pushed()
+        {
+            ++_push_seq;
+            if (!_exited)
+            {
+                _cond_con.notify_one();
+                return;
             }
+            _con_buf.swap(_pro_buf);
+            _callback(_con_buf);
+            _con_buf.reset();
+            _done_seq = _push_seq;
+        }
+        /*
+            安全模式下能否写入len字节：剩余空间足够，或者缓冲区为空(超过缓冲区大小的日志写入空缓冲区，缓冲区临时扩容，
+            否则这样的日志永远等不到足够的空间)；调用时需持有锁
+        */
+        bool fits(size_t len)
+        {
+            return _pro_buf.writeAbleSize() >= len || _pro_buf.empty();
+        }
+        // 把排队的日志按顺序写入生产缓冲区；调用时需持有锁
+        void admitWaiters(std::vector<std::function<void()>> &notify)
+        {
+            size_t n = 0;
+            for (; n < _waiters.size(); ++n)
+            {
+                Waiter &waiter = _waiters[n];
+                if (!fits(waiter.data.size()))
+                    break;
+                struct iovec iov = {&waiter.data[0], waiter.data.size()};
+                _pro_buf.push(&iov, 1, waiter.record);
+                ++_push_seq;
+                notify.push_back(std::move(waiter.cb));
+            }
+            _waiters.erase(_waiters.begin(), _waiters.begin() + n);
+        }
+        // 在锁外调用通知回调
+        static void runNotify(std::vector<std::function<void()>> &notify)
+        {
+            for (auto &cb : notify)
+                cb();
+            notify.clear();
         }
 
     private:
         Functor _callback; // 回调函数
     private:
         AsyncType _looper_type;
+        LooperOptions _options;
+        size_t _buffer_size;     // 缓冲区的大小，工作线程分配后为分配器给出的实际容量
+        Allocator::ptr _alloc;   // 缓冲区的分配器
         std::atomic<bool> _stop; // 工作器停止标志
+        bool _ready;             // 缓冲区已经分配完毕
+        bool _exited;            // 工作线程已经退出
         Buffer _pro_buf;         // 生产缓冲区
         Buffer _con_buf;         // 消费缓冲区
+        uint64_t _push_seq;      // 已写入的日志条数
+        uint64_t _swap_seq;      // 消费缓冲区中最后一条日志的序号
+        uint64_t _done_seq;      // 已处理完毕的日志条数
         std::mutex _mutex;
         std::condition_variable _cond_pro;
         std::condition_variable _cond_con;
+        std::condition_variable _cond_flush;
+        struct Waiter
+        {
+            std::string data;
+            LogRecord record;
+            std::function<void()> cb;
+        };
+        std::deque<Waiter> _waiters;                                           // 等待空间的日志(pushOrNotify)
+        std::vector<std::pair<uint64_t, std::function<void()>>> _flush_waiters; // 等待处理完毕的通知(flushOrNotify)
         std::thread _thread; // 异步工作器对应的线程
     };
+
+    /*
+        共享的异步线程池：多个异步日志器复用固定数量的工作线程和缓冲区，线程数和内存不随日志器数量增长
+        每个日志器固定分配给一个工作线程，同一日志器的日志按写入顺序处理；
+        工作线程的缓冲区中混有多个日志器的数据，处理时按输出记录的日志器切分后分别交付(没有落地方向的子日志器的记录交给其祖先)
+    */
+    using BatchFunctor = std::function<void(const char *, size_t, const LogRecord *, size_t)>;
+    class LooperPool
+    {
+    public:
+        using ptr = std::shared_ptr<LooperPool>;
+        LooperPool(size_t workers = 2, AsyncType looper_type = AsyncType::ASYNC_SAFE, size_t buffer_size = DEFAULT_BUFFER_SIZE,
+                   const LooperOptions &options = LooperOptions(), const Allocator::ptr &alloc = Allocator::getDefault())
+            : _next(0)
+        {
+            if (workers == 0)
+                workers = 1;
+            for (size_t i = 0; i < workers; ++i)
+            {
+                LooperOptions opts = options;
+                if (!opts.name.empty())
+                    opts.name += std::to_string(i);
+                _loopers.push_back(std::make_shared<AsyncLooper>(std::bind(&LooperPool::dispatch, this, std::placeholders::_1),
+                                                                 looper_type, buffer_size, opts, alloc));
+            }
+        }
+        ~LooperPool()
+        {
+            // 先停止工作线程，再销毁分发表
+            for (auto &looper : _loopers)
+                looper->stop();
+        }
+        // 登记日志器，key为其名称的地址(记录中的_owner)，返回分配给它的工作线程
+        AsyncLooper::ptr attach(const std::string *key, const BatchFunctor &cb)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _callbacks[key] = cb;
+            return _loopers[_next++ % _loopers.size()];
+        }
+        // 注销日志器：等待其已写入的数据处理完毕后再移除，之后不再回调
+        void detach(const std::string *key, const AsyncLooper::ptr &looper)
+        {
+            looper->flush();
+            std::unique_lock<std::mutex> lock(_mutex);
+            _callbacks.erase(key);
+        }
+        size_t size()
+        {
+            return _loopers.size();
+        }
+        // 进程内默认的共享线程池，首次调用时按workers创建
+        static ptr global(size_t workers = 2)
+        {
+            static ptr pool = create(workers);
+            return pool;
+        }
+
+    private:
+        static ptr create(size_t workers)
+        {
+            LooperOptions options;
+            options.name = "mylog-pool";
+            return std::make_shared<LooperPool>(workers, AsyncType::ASYNC_SAFE, DEFAULT_BUFFER_SIZE, options);
+        }
+        void dispatch(Buffer &buf)
+        {
+            const char *data = buf.begin();
+            const LogRecord *records = buf.records();
+            size_t count = buf.recordCount();
+            // 连续的记录通常属于同一个日志器，合并为一批交付
+            for (size_t i = 0; i < count;)
+            {
+                size_t j = i, len = 0;
+                for (; j < count && records[j]._owner == records[i]._owner; ++j)
+                    len += records[j]._len;
+                BatchFunctor *cb = find(records[i]._owner);
+                if (cb)
+                    (*cb)(data, len, records + i, j - i);
+                data += len;
+                i = j;
+            }
+        }
+        BatchFunctor *find(const std::string *key)
+        {
+            // 元素的地址在rehash后保持不变，注销前会等待数据处理完毕，因此可以在锁外调用
+            std::unique_lock<std::mutex> lock(_mutex);
+            auto it = _callbacks.find(key);
+            return it == _callbacks.end() ? nullptr : &it->second;
+        }
+
+    private:
+        std::mutex _mutex;
+        size_t _next;
+        std::unordered_map<const std::string *, BatchFunctor> _callbacks;
+        std::vector<AsyncLooper::ptr> _loopers; // 最后声明，最先析构
+    };
+#define DEFAULT_RT_SLOT_COUNT 4096
+#define DEFAULT_RT_SLOT_SIZE 256
+#define RT_IDLE_SPIN 1000      // 没有数据时先空转的次数
+#define RT_IDLE_SLEEP_US 200   // 之后每次休眠的微秒数
+
+    // 实时模式中的一条日志，位于槽的开头，之后依次为诊断上下文的mdc_count个MdcEntry、mdc_len字节的上下文文本和消息主体
+    struct RtRecord
+    {
+        std::atomic<uint64_t> seq; // 槽的状态：等于位置时空闲，等于位置+1时已写好
+        uint64_t ticks;            // 时间戳(TscClock的原始计数)
+        LogLevel::value level;
+        uint32_t len;              // 消息主体的长度
+        uint32_t mdc_count;
+        uint32_t mdc_len;
+        size_t line;
+        const char *file;
+        util::ThreadInfo tid;
+    };
+
+    /*
+        实时模式的异步工作器：固定数量、固定大小的槽在创建时一次分配并写入物理页，
+        生产者通过CAS预留槽位(有界多生产者队列)，没有空闲槽时立即失败，不加锁、不分配内存、不进行系统调用；
+        消费者线程轮询已写好的槽(空闲时短暂休眠)，生产者也不需要唤醒它
+    */
+    class RealtimeLooper
+    {
+    public:
+        using ptr = std::shared_ptr<RealtimeLooper>;
+        using Handler = std::function<void(const RtRecord &, const char *)>;
+        RealtimeLooper(const Handler &cb, size_t slot_count = DEFAULT_RT_SLOT_COUNT, size_t slot_size = DEFAULT_RT_SLOT_SIZE,
+                       const LooperOptions &options = LooperOptions(), const Allocator::ptr &alloc = Allocator::getDefault())
+            : _callback(cb), _options(options), _alloc(alloc), _slots(nullptr), _stop(false), _ready(false),
+              _head(0), _tail(0), _flush_target(0), _done(0), _dropped(0)
+        {
+            _slot_count = 1;
+            while (_slot_count < slot_count)
+                _slot_count <<= 1;
+            // 槽按缓存行对齐，相邻的槽不会互相干扰
+            _slot_size = (std::max(slot_size, sizeof(RtRecord) + 16) + 63) & ~(size_t)63;
+            _mem_size = _slot_count * _slot_size + 64;
+            _thread = std::thread(&RealtimeLooper::threadEntry, this);
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cond.wait(lock, [&]()
+                       { return _ready; });
+        }
+        ~RealtimeLooper()
+        {
+            stop();
+            if (_mem)
+                _alloc->deallocate(_mem, _mem_size);
+        }
+        // 预留一个槽，没有空闲槽时返回nullptr；写好后调用commit
+        RtRecord *reserve(uint64_t &pos)
+        {
+            pos = _tail.load(std::memory_order_relaxed);
+            while (true)
+            {
+                RtRecord *rec = slot(pos);
+                int64_t diff = (int64_t)(rec->seq.load(std::memory_order_acquire) - pos);
+                if (diff == 0)
+                {
+                    if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        return rec;
+                }
+                else if (diff < 0)
+                {
+                    _dropped.fetch_add(1, std::memory_order_relaxed);
+                    return nullptr;
+                }
+                else
+                    pos = _tail.load(std::memory_order_relaxed);
+            }
+        }
+        void commit(RtRecord *rec, uint64_t pos)
+        {
+            rec->seq.store(pos + 1, std::memory_order_release);
+        }
+        static char *payload(RtRecord *rec)
+        {
+            return reinterpret_cast<char *>(rec + 1);
+        }
+        size_t payloadCapacity()
+        {
+            return _slot_size - sizeof(RtRecord);
+        }
+        // 因没有空闲槽而丢弃的日志条数
+        size_t dropped()
+        {
+            return _dropped.load(std::memory_order_relaxed);
+        }
+        // 等待调用之前预留的槽全部处理完毕
+        bool flush(int timeout_ms = -1)
+        {
+            uint64_t target = _tail.load(std::memory_order_acquire);
+            // 登记等待的位置，消费者在持续处理时越过该位置也会公布进度，不必等到空闲
+            uint64_t pending = _flush_target.load(std::memory_order_relaxed);
+            while (pending < target && !_flush_target.compare_exchange_weak(pending, target, std::memory_order_release))
+                ;
+            std::unique_lock<std::mutex> lock(_mutex);
+            auto done = [&]()
+            { return _done >= target || !_thread.joinable(); };
+            if (timeout_ms < 0)
+            {
+                _cond.wait(lock, done);
+                return true;
+            }
+            return _cond.wait_for(lock, std::chrono::milliseconds(timeout_ms), done);
+        }
+        void stop()
+        {
+            _stop = true;
+            if (_thread.joinable())
+                _thread.join();
+            _cond.notify_all();
+        }
+        std::thread::id threadId()
+        {
+            return _thread.get_id();
+        }
+
+    private:
+        RtRecord *slot(uint64_t pos)
+        {
+            return reinterpret_cast<RtRecord *>(_slots + (pos & (_slot_count - 1)) * _slot_size);
+        }
+        // 公布处理进度并唤醒等待的flush
+        uint64_t publish(uint64_t done)
+        {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _done = done;
+            }
+            _cond.notify_all();
+            return done;
+        }
+        void threadEntry()
+        {
+            AsyncLooper::applyOptions(_options);
+            {
+                // 与AsyncLooper相同，在工作线程中分配并初始化，内存页位于工作线程所在的NUMA节点
+                size_t size = _mem_size;
+                _mem = _alloc->allocate(size);
+                assert(_mem != nullptr);
+                _mem_size = size;
+                _slots = reinterpret_cast<char *>(((uintptr_t)_mem + 63) & ~(uintptr_t)63);
+                memset(_mem, 0, _mem_size);
+                for (size_t i = 0; i < _slot_count; ++i)
+                    new (slot(i)) RtRecord();
+                for (size_t i = 0; i < _slot_count; ++i)
+                    slot(i)->seq.store(i, std::memory_order_relaxed);
+                std::unique_lock<std::mutex> lock(_mutex);
+                _ready = true;
+            }
+            _cond.notify_all();
+            size_t idle = 0;
+            uint64_t published = 0; // 最近一次公布的_done
+            while (true)
+            {
+                uint64_t head = _head;
+                RtRecord *rec = slot(head);
+                if (rec->seq.load(std::memory_order_acquire) != head + 1)
+                {
+                    // 没有已写好的槽：已经停止且没有预留中的槽时退出
+                    if (_stop && _tail.load(std::memory_order_acquire) == head)
+                        break;
+                    if (idle++ == 0)
+                        published = publish(head);
+                    if (idle > RT_IDLE_SPIN)
+                        usleep(RT_IDLE_SLEEP_US);
+                    continue;
+                }
+                idle = 0;
+                _callback(*rec, payload(rec));
+                rec->seq.store(head + _slot_count, std::memory_order_release);
+                _head = head + 1;
+                // 有等待中的flush且已处理到它的位置时立即公布，持续有数据时flush也不会等到超时
+                uint64_t target = _flush_target.load(std::memory_order_acquire);
+                if (target > published && _head >= target)
+                    published = publish(_head);
+            }
+            std::unique_lock<std::mutex> lock(_mutex);
+            _done = _head;
+        }
+
+    private:
+        Handler _callback;
+        LooperOptions _options;
+        Allocator::ptr _alloc;
+        char *_mem = nullptr;
+        size_t _mem_size;
+        char *_slots;
+        size_t _slot_count;
+        size_t _slot_size;
+        std::atomic<bool> _stop;
+        bool _ready;
+        uint64_t _head; // 只由消费者线程访问
+        alignas(64) std::atomic<uint64_t> _tail;
+        alignas(64) std::atomic<uint64_t> _flush_target; // 等待中的flush的最大位置
+        uint64_t _done;                                  // 已处理完毕的位置，受_mutex保护
+        std::atomic<size_t> _dropped;
+        std::mutex _mutex;
+        std::condition_variable _cond;
+        std::thread _thread;
+    };
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,165 @@
+#ifndef __MY_MDC__
+#define __MY_MDC__
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mylog
+{
+    // 上下文中的一项在渲染结果中的位置
+    struct MdcEntry
+    {
+        uint32_t key;
+        uint32_t key_len;
+        uint32_t value;
+        uint32_t value_len;
+    };
+    // 渲染好的上下文："key1=value1 key2=value2"，entries为各项在其中的位置，按设置的先后排列
+    struct MdcView
+    {
+        const char *data;
+        size_t len;
+        const MdcEntry *entries;
+        size_t count;
+
+        // 查找key对应的值，不存在时返回false
+        bool find(const char *key, size_t key_len, const char *&value, size_t &value_len) const
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (entries[i].key_len == key_len && memcmp(data + entries[i].key, key, key_len) == 0)
+                {
+                    value = data + entries[i].value;
+                    value_len = entries[i].value_len;
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+
+    /*
+        线程私有的诊断上下文(MDC)：请求号、用户号等附加在本线程之后的每条日志上，格式中用%X引用(见Formatter)
+            MDC::Scope scope("req", req_id);   // 作用域结束时恢复原来的值
+        上下文只在修改时渲染为一段连续的文本，写日志时只记录其地址(同步/异步日志器在调用线程中直接拷贝)，
+        实时日志器把这段文本拷贝到槽中，由后台线程格式化
+    */
+    class MDC
+    {
+    public:
+        // 设置key的值，已存在时替换(位置不变)
+        static void put(const std::string &key, const std::string &value)
+        {
+            Context &ctx = context();
+            for (auto &entry : ctx.entries)
+            {
+                if (entry.first == key)
+                {
+                    entry.second = value;
+                    ctx.render();
+                    return;
+                }
+            }
+            ctx.entries.push_back(std::make_pair(key, value));
+            ctx.render();
+        }
+        static void remove(const std::string &key)
+        {
+            Context &ctx = context();
+            for (auto it = ctx.entries.begin(); it != ctx.entries.end(); ++it)
+            {
+                if (it->first == key)
+                {
+                    ctx.entries.erase(it);
+                    ctx.render();
+                    return;
+                }
+            }
+        }
+        static void clear()
+        {
+            Context &ctx = context();
+            ctx.entries.clear();
+            ctx.render();
+        }
+        // key不存在时返回false
+        static bool get(const std::string &key, std::string &value)
+        {
+            const char *data;
+            size_t len;
+            if (!view().find(key.data(), key.size(), data, len))
+                return false;
+            value.assign(data, len);
+            return true;
+        }
+        // 当前线程渲染好的上下文，在本线程下一次修改上下文之前有效
+        static const MdcView &view()
+        {
+            return context().view;
+        }
+        // 作用域内设置key的值，析构时恢复为原来的值(原来不存在时删除)；同一线程中按后进先出的顺序析构
+        class Scope
+        {
+        public:
+            Scope(const std::string &key, const std::string &value) : _key(key)
+            {
+                _had = get(key, _old);
+                put(key, value);
+            }
+            ~Scope()
+            {
+                if (_had)
+                    put(_key, _old);
+                else
+                    remove(_key);
+            }
+            Scope(const Scope &) = delete;
+            Scope &operator=(const Scope &) = delete;
+
+        private:
+            std::string _key;
+            std::string _old;
+            bool _had;
+        };
+
+    private:
+        struct Context
+        {
+            std::vector<std::pair<std::string, std::string>> entries;
+            std::string text;
+            std::vector<MdcEntry> index;
+            MdcView view;
+
+            Context() : view{"", 0, nullptr, 0} {}
+            void render()
+            {
+                text.clear();
+                index.clear();
+                for (auto &entry : entries)
+                {
+                    if (text.size())
+                        text.push_back(' ');
+                    MdcEntry pos;
+                    pos.key = text.size();
+                    pos.key_len = entry.first.size();
+                    text += entry.first;
+                    text.push_back('=');
+                    pos.value = text.size();
+                    pos.value_len = entry.second.size();
+                    text += entry.second;
+                    index.push_back(pos);
+                }
+                view = {text.data(), text.size(), index.data(), index.size()};
+            }
+        };
+        static Context &context()
+        {
+            static thread_local Context ctx;
+            return ctx;
+        }
+    };
+}
+
+#endif
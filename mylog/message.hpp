@@ -6,22 +6,43 @@
 #include <ctime>
 #include "level.hpp"
 #include "util.hpp"
+#include "mdc.hpp"
 
 namespace mylog
 {
   struct logMsg
   {
-    time_t _ctime;          // 时间戳
-    LogLevel::value _level; // 日志等级
-    size_t _line;           // 行号
-    std::thread::id _tid;   // 线程id
-    std::string _file;      // 源文件名
-    std::string _logger;    // 日志器名
-    std::string _payload;   // 有效消息数据
-    logMsg(const LogLevel::value level, size_t line, const std::string file, const std::string logger, const std::string msg)
-        : _ctime(util::Date::getTime()), _level(level), _line(line), _tid(std::this_thread::get_id()), _file(file), _logger(logger), _payload(msg)
+    int64_t _ns;                  // 时间戳(自1970年以来的纳秒数，来自util::Clock)
+    time_t _ctime;                // 时间戳(秒)
+    LogLevel::value _level;       // 日志等级
+    size_t _line;                 // 行号
+    const util::ThreadInfo *_tid; // 线程标识(线程私有的缓存，格式化前有效)
+    const char *_file;            // 源文件名(调用处的__FILE__，不拷贝)
+    const std::string &_logger;   // 日志器名(引用日志器自身保存的名称)
+    const std::string &_payload;  // 有效消息数据(引用调用线程私有的字符串，不拷贝)
+    const MdcView *_mdc;          // 诊断上下文(引用线程私有的渲染结果，格式化前有效)
+    logMsg(const LogLevel::value level, size_t line, const char *file, const std::string &logger, const std::string &msg)
+        : _ns(util::Clock::nowNs()), _ctime(_ns / 1000000000), _level(level), _line(line), _tid(&util::Thread::current()), _file(file), _logger(logger), _payload(msg),
+          _mdc(&MDC::view())
     {
     }
+    // 在其他线程中处理之前记录下来的日志时，使用记录的时间、线程和上下文
+    logMsg(const LogLevel::value level, size_t line, const char *file, const std::string &logger, const std::string &msg, int64_t ns, const util::ThreadInfo *tid,
+           const MdcView *mdc)
+        : _ns(ns), _ctime(ns / 1000000000), _level(level), _line(line), _tid(tid), _file(file), _logger(logger), _payload(msg), _mdc(mdc)
+    {
+    }
+  };
+
+  // 一条已格式化日志的元信息，与日志数据一起交给落地方向，便于按条处理(例如建立索引)
+  struct LogRecord
+  {
+    size_t _len;                 // 格式化后的长度，多条记录在数据中依次排列
+    time_t _ctime;               // 时间戳
+    LogLevel::value _level;      // 日志等级
+    const std::string *_logger;  // 日志器名
+    uint64_t _sinks;             // 接收这条日志的落地方向，第i位对应日志器的第i个落地方向
+    const std::string *_owner;   // 输出这条日志的日志器(自身或有落地方向的祖先)的名称，共享线程池按它分发
   };
 }
 
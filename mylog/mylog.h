@@ -14,6 +14,12 @@ namespace mylog
         return LoggerManager::getInstance().rootLogger();
     }
 
+    // 进程退出前调用，在timeout_ms内尽量把所有日志器中的数据落地
+    bool shutdown(int timeout_ms)
+    {
+        return LoggerManager::getInstance().shutdown(timeout_ms);
+    }
+
 // 使用宏函数对接口进行代理
 #define debug(fmt, ...) debug(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
 #define info(fmt, ...) info(__FILE__, __LINE__, fmt, ##__VA_ARGS__)
@@ -0,0 +1,388 @@
+#ifndef __MY_SHM__
+#define __MY_SHM__
+#include "util.hpp"
+#include "sink.hpp"
+#include <atomic>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+
+namespace mylog
+{
+#define DEFAULT_SHM_RING_SIZE (4 * 1024 * 1024)
+#define SHM_RING_MAGIC 0x6d796c67
+#define SHM_MAX_WRITERS 6 // 登记的生产者进程数上限，超出后不再自动恢复
+    static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "共享内存环形队列要求64位原子操作无锁");
+
+    /*
+        POSIX共享内存中的无锁环形队列(多生产者、单消费者)
+        内存布局: [ShmRingHeader][data区(容量为2的幂)]
+        每条记录: [RecordHeader(8字节)][日志数据][填充至8字节对齐]
+        生产者通过CAS预留空间，写完数据后置位提交标志；消费者只读取已提交的记录，
+        读完后将整条记录清零再推进读位置，因此进程崩溃后已提交的日志仍保留在共享内存中
+        生产者进程在队列头部登记pid，收集器只在所有登记的生产者都已退出时才跳过未提交的记录(见recover)
+    */
+    class ShmRing
+    {
+    public:
+        using ptr = std::shared_ptr<ShmRing>;
+        ShmRing(const std::string &name, size_t capacity = DEFAULT_SHM_RING_SIZE)
+            : _name(shmName(name)), _header(nullptr), _data(nullptr), _map_size(0), _mask(0)
+        {
+            capacity = roundUp(capacity);
+            bool creator = true;
+            int fd = shm_open(_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0666);
+            if (fd < 0 && errno == EEXIST)
+            {
+                creator = false;
+                fd = shm_open(_name.c_str(), O_RDWR, 0666);
+            }
+            if (fd < 0)
+            {
+                std::cout << "共享内存打开失败: " << _name << " " << strerror(errno) << std::endl;
+                return;
+            }
+            if (creator)
+            {
+                // 长度不足时映射后的写入会触发SIGBUS，失败时删除这个不完整的共享内存
+                _map_size = sizeof(ShmRingHeader) + capacity;
+                if (ftruncate(fd, _map_size) != 0)
+                {
+                    std::cout << "共享内存设置大小失败: " << _name << " " << strerror(errno) << std::endl;
+                    close(fd);
+                    shm_unlink(_name.c_str());
+                    return;
+                }
+            }
+            else
+            {
+                // 等待创建者完成ftruncate，容量以创建者为准
+                struct stat st = {};
+                while (fstat(fd, &st) == 0 && (size_t)st.st_size <= sizeof(ShmRingHeader))
+                    usleep(1000);
+                _map_size = st.st_size;
+            }
+            void *addr = mmap(nullptr, _map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            if (addr == MAP_FAILED)
+            {
+                std::cout << "共享内存映射失败: " << _name << " " << strerror(errno) << std::endl;
+                return;
+            }
+            _header = static_cast<ShmRingHeader *>(addr);
+            _data = static_cast<char *>(addr) + sizeof(ShmRingHeader);
+            if (creator)
+            {
+                _header->capacity = _map_size - sizeof(ShmRingHeader);
+                _header->write_pos.store(0, std::memory_order_relaxed);
+                _header->read_pos.store(0, std::memory_order_relaxed);
+                _header->dropped.store(0, std::memory_order_relaxed);
+                _header->untracked.store(0, std::memory_order_relaxed);
+                _header->recovering.store(0, std::memory_order_relaxed);
+                for (auto &writer : _header->writers)
+                    writer.store(0, std::memory_order_relaxed);
+                _header->magic.store(SHM_RING_MAGIC, std::memory_order_release);
+            }
+            else
+            {
+                while (_header->magic.load(std::memory_order_acquire) != SHM_RING_MAGIC)
+                    usleep(1000);
+            }
+            _mask = _header->capacity - 1;
+        }
+        ~ShmRing()
+        {
+            if (_header)
+                munmap(_header, _map_size);
+        }
+        // 共享内存是否打开成功，失败时各操作不做任何事
+        bool valid()
+        {
+            return _header != nullptr;
+        }
+        /*
+            生产者登记自己的pid，便于收集器判断生产者是否都已经退出；优先使用空位，其次使用已退出的进程留下的位置，
+            登记表已满时该队列不再自动恢复
+        */
+        void attachProducer()
+        {
+            if (!_header)
+                return;
+            // 登记与recover中的扫描都使用顺序一致的原子操作，见recover
+            int32_t pid = getpid();
+            for (auto &writer : _header->writers)
+            {
+                int32_t expected = 0;
+                if (writer.compare_exchange_strong(expected, pid))
+                    return;
+            }
+            for (auto &writer : _header->writers)
+            {
+                int32_t expected = writer.load();
+                if (kill(expected, 0) != 0 && errno == ESRCH && writer.compare_exchange_strong(expected, pid))
+                    return;
+            }
+            _header->untracked.store(1);
+        }
+        // 正常退出的生产者注销登记(崩溃的生产者由recover判断)
+        void detachProducer()
+        {
+            if (!_header)
+                return;
+            int32_t pid = getpid();
+            for (auto &writer : _header->writers)
+            {
+                int32_t expected = pid;
+                if (writer.compare_exchange_strong(expected, 0, std::memory_order_acq_rel))
+                    return;
+            }
+        }
+        // 写入一条记录，队列已满或收集器正在恢复队列时直接丢弃并计数，不会阻塞
+        bool push(const char *data, size_t len)
+        {
+            if (!_header)
+                return false;
+            size_t need = align(sizeof(RecordHeader) + len);
+            uint64_t w, pad, total;
+            while (true)
+            {
+                if (_header->recovering.load())
+                {
+                    _header->dropped.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                w = _header->write_pos.load(std::memory_order_relaxed);
+                size_t contig = _header->capacity - (w & _mask);
+                pad = need > contig ? contig : 0;
+                total = pad + need;
+                uint64_t r = _header->read_pos.load(std::memory_order_acquire);
+                if (w + total - r > _header->capacity)
+                {
+                    _header->dropped.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                if (_header->write_pos.compare_exchange_weak(w, w + total, std::memory_order_acq_rel))
+                    break;
+            }
+            if (pad)
+                commit(w, pad - sizeof(RecordHeader), RECORD_PAD);
+            // 先写下预留的长度，生产者在拷贝数据时崩溃，收集器也能只跳过这一条(见recover)
+            RecordHeader *rh = record(w + pad);
+            rh->len = len;
+            rh->flags = RECORD_RESERVED;
+            memcpy(reinterpret_cast<char *>(record(w + pad)) + sizeof(RecordHeader), data, len);
+            commit(w + pad, len, 0);
+            return true;
+        }
+        // 消费所有已提交的记录，只能由单个消费者调用，返回消费的字节数
+        template <typename Callback>
+        size_t drain(Callback &&cb)
+        {
+            if (!_header)
+                return 0;
+            size_t bytes = 0;
+            uint64_t r = _header->read_pos.load(std::memory_order_relaxed);
+            while (true)
+            {
+                RecordHeader *rh = record(r);
+                if (rh->state.load(std::memory_order_acquire) == 0)
+                    break;
+                if (!(rh->flags & RECORD_PAD))
+                {
+                    cb(reinterpret_cast<const char *>(rh + 1), (size_t)rh->len);
+                    bytes += rh->len;
+                }
+                // 整条记录清零：下一轮写入时记录头可能落在本条记录的数据区，不能残留非零的提交标志
+                size_t advance = align(sizeof(RecordHeader) + rh->len);
+                memset(reinterpret_cast<char *>(rh), 0, advance);
+                r += advance;
+                _header->read_pos.store(r, std::memory_order_release);
+            }
+            return bytes;
+        }
+        /*
+            生产者在预留空间后、提交前崩溃会使队列停滞，只能由收集器(消费者)在drain取不到数据时调用
+            只有登记过生产者、登记表没有溢出且登记的生产者都已退出时才进行，否则仍在写入的生产者的数据会被破坏
+            恢复期间置位recovering，生产者看到后不再预留空间：先置位再扫描登记表(均为顺序一致的操作)，
+            扫描时没有看到的新生产者一定能看到该标志；之后再读取写位置，此前的预留都属于已退出的生产者
+            恢复时遍历[r, w)：已提交的记录保留，写下了预留长度的未提交记录改为填充记录，
+            预留后还没来得及写记录头的(长度未知)则丢弃从它开始到w的部分；返回是否丢弃了数据
+        */
+        bool recover()
+        {
+            if (!_header)
+                return false;
+            uint64_t r = _header->read_pos.load(std::memory_order_relaxed);
+            if (r == _header->write_pos.load(std::memory_order_acquire) || !producersExited())
+                return false;
+            _header->recovering.store(1);
+            bool discarded = false;
+            if (producersExited())
+            {
+                uint64_t w = _header->write_pos.load();
+                for (uint64_t pos = r; pos != w;)
+                {
+                    RecordHeader *rh = record(pos);
+                    if (rh->state.load(std::memory_order_acquire) == 0)
+                    {
+                        discarded = true;
+                        if (!(rh->flags & RECORD_RESERVED))
+                        {
+                            discardRange(pos, w);
+                            break;
+                        }
+                        memset(reinterpret_cast<char *>(rh + 1), 0, rh->len);
+                        commit(pos, rh->len, RECORD_PAD);
+                    }
+                    pos += align(sizeof(RecordHeader) + rh->len);
+                }
+            }
+            _header->recovering.store(0);
+            return discarded;
+        }
+        size_t dropped()
+        {
+            return _header ? _header->dropped.load(std::memory_order_relaxed) : 0;
+        }
+        size_t maxRecordSize()
+        {
+            return _header ? _header->capacity / 4 : 0;
+        }
+        const std::string &name()
+        {
+            return _name;
+        }
+        static void unlink(const std::string &name)
+        {
+            shm_unlink(shmName(name).c_str());
+        }
+
+    private:
+        enum
+        {
+            RECORD_PAD = 1,
+            RECORD_RESERVED = 2 // 已预留、正在写入，只在未提交时出现
+        };
+        struct RecordHeader
+        {
+            std::atomic<uint16_t> state; // 0:未提交 1:已提交
+            uint16_t flags;
+            uint32_t len;
+        };
+        struct ShmRingHeader
+        {
+            std::atomic<uint32_t> magic;
+            std::atomic<uint32_t> untracked; // 有生产者因登记表已满没有登记
+            uint64_t capacity;
+            std::atomic<uint64_t> dropped;
+            std::atomic<int32_t> writers[SHM_MAX_WRITERS]; // 登记的生产者pid，0表示空位
+            std::atomic<uint32_t> recovering;              // 收集器正在丢弃未提交的部分
+            alignas(64) std::atomic<uint64_t> write_pos; // 生产者和消费者的位置分开在不同缓存行
+            alignas(64) std::atomic<uint64_t> read_pos;
+        };
+        // 登记过生产者、登记表没有溢出，并且登记的生产者都已退出
+        bool producersExited()
+        {
+            if (_header->untracked.load())
+                return false;
+            bool registered = false;
+            for (auto &writer : _header->writers)
+            {
+                pid_t pid = writer.load();
+                if (pid == 0)
+                    continue;
+                if (kill(pid, 0) == 0 || errno != ESRCH)
+                    return false;
+                registered = true;
+            }
+            return registered;
+        }
+        // 把[pos, w)清零并改为填充记录，填充记录不能跨越data区的末尾，按环形分段处理
+        void discardRange(uint64_t pos, uint64_t w)
+        {
+            while (pos != w)
+            {
+                size_t len = std::min((uint64_t)(_header->capacity - (pos & _mask)), w - pos);
+                memset(_data + (pos & _mask), 0, len);
+                commit(pos, len - sizeof(RecordHeader), RECORD_PAD);
+                pos += len;
+            }
+        }
+        RecordHeader *record(uint64_t pos)
+        {
+            return reinterpret_cast<RecordHeader *>(_data + (pos & _mask));
+        }
+        void commit(uint64_t pos, size_t len, uint16_t flags)
+        {
+            RecordHeader *rh = record(pos);
+            rh->len = len;
+            rh->flags = flags;
+            rh->state.store(1, std::memory_order_release);
+        }
+        static size_t align(size_t len)
+        {
+            return (len + 7) & ~(size_t)7;
+        }
+        static size_t roundUp(size_t size)
+        {
+            size_t cap = 4096;
+            while (cap < size)
+                cap <<= 1;
+            return cap;
+        }
+        static std::string shmName(const std::string &name)
+        {
+            if (!name.empty() && name[0] == '/')
+                return name;
+            return "/mylog-" + name;
+        }
+
+    private:
+        std::string _name;
+        ShmRingHeader *_header;
+        char *_data;
+        size_t _map_size;
+        uint64_t _mask;
+    };
+
+    // 落地方向：共享内存环形队列，由独立的收集进程(collector)负责写入文件
+    class ShmSink : public LogSink
+    {
+    public:
+        ShmSink(const std::string &name, size_t capacity = DEFAULT_SHM_RING_SIZE)
+            : _ring(std::make_shared<ShmRing>(name, capacity))
+        {
+            _ring->attachProducer();
+        }
+        ~ShmSink()
+        {
+            _ring->detachProducer();
+        }
+        void log(const char *data, const size_t &len)
+        {
+            if (!_ring->valid())
+                return;
+            // 超过单条记录上限的数据(例如异步日志器一次交付的整块缓冲区)拆分写入
+            size_t max_len = _ring->maxRecordSize();
+            for (size_t off = 0; off < len; off += max_len)
+                _ring->push(data + off, std::min(max_len, len - off));
+        }
+        size_t dropped()
+        {
+            return _ring->dropped();
+        }
+        // 环形队列本身支持多生产者
+        bool threadSafe() const
+        {
+            return true;
+        }
+
+    private:
+        ShmRing::ptr _ring;
+    };
+}
+
+#endif
@@ -1,20 +1,136 @@
 #ifndef __LOG_SINK__
 #define __LOG_SINK__
 #include "util.hpp"
+#include "message.hpp"
+#include "index.hpp"
+#include "format.hpp"
+#include <atomic>
 #include <cassert>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <deque>
+#include <vector>
 #include <fstream>
 #include <sstream>
+#include <string>
 
 namespace mylog
 {
+    // 一批日志：iov中依次排列着records描述的各条日志
+    struct LogBatch
+    {
+        const struct iovec *iov;
+        int iovcnt;
+        const LogRecord *records;
+        size_t count;
+    };
+
     class LogSink
     {
     public:
         using ptr = std::shared_ptr<LogSink>;
-        LogSink(){};
+        using Filter = std::function<bool(const logMsg &)>;
+        LogSink() : _level(LogLevel::value::DEBUG), _write_errors(0), _failing(false){};
         virtual ~LogSink(){};
+        // 只输出不低于level的日志
+        void setLevel(LogLevel::value level)
+        {
+            _level = level;
+        }
+        // 额外的过滤条件(例如按日志器名、源文件或消息内容)，返回false的日志不输出
+        void setFilter(const Filter &filter)
+        {
+            _filter = filter;
+        }
+        // 该落地方向单独使用的格式，需要在创建日志器之前设置；未设置时使用日志器的格式
+        void setFormatter(const Formatter::ptr &formatter)
+        {
+            _formatter = formatter;
+        }
+        Formatter::ptr getFormatter()
+        {
+            return _formatter;
+        }
+        // 在格式化之前由日志器调用，判断是否输出这条日志
+        bool accept(const logMsg &msg)
+        {
+            return msg._level >= _level && (!_filter || _filter(msg));
+        }
         virtual void log(const char *data, const size_t &len) = 0;
+        // 分段落地，一次调用对应一条完整日志；默认拼接后调用log，支持writev的落地方向可以重写以省去拼接
+        virtual void log(const struct iovec *iov, int iovcnt)
+        {
+            if (iovcnt == 1)
+                return log(static_cast<const char *>(iov[0].iov_base), iov[0].iov_len);
+            static thread_local std::string joined;
+            joined.clear();
+            for (int i = 0; i < iovcnt; ++i)
+                joined.append(static_cast<const char *>(iov[i].iov_base), iov[i].iov_len);
+            log(joined.data(), joined.size());
+        }
+        // 把已经写入的数据交给操作系统；直接写文件描述符的落地方向没有用户态缓冲，无需处理
+        virtual void flush()
+        {
+        }
+        // 带元信息的落地，需要按条处理的落地方向重写，默认忽略元信息
+        virtual void log(const LogBatch &batch)
+        {
+            log(batch.iov, batch.iovcnt);
+        }
+        /*
+            是否可以被多个线程同时调用log(且每次调用的数据不会与其他调用交错)
+            同步日志器直接在各线程中调用线程安全的落地方向，其余的落地方向按各自的互斥锁串行调用
+        */
+        virtual bool threadSafe() const
+        {
+            return false;
+        }
+        // 同步日志器调用非线程安全的落地方向时使用的锁，同一落地方向被多个日志器共用时也能互斥
+        std::mutex &mutex()
+        {
+            return _mutex;
+        }
+        /*
+            异步写入：发起写入后即可返回，写完后调用done(可以在其他线程中调用)，调用done之前batch引用的数据保持有效
+            异步日志器把一批数据同时交给各落地方向，等全部完成后再处理下一批；默认同步写入后直接调用done
+        */
+        virtual void logAsync(const LogBatch &batch, const std::function<void()> &done)
+        {
+            log(batch);
+            done();
+        }
+        // 写入失败(例如磁盘已满)的次数，失败的日志全部或部分丢失
+        size_t writeErrors()
+        {
+            return _write_errors.load(std::memory_order_relaxed);
+        }
+
+    protected:
+        // 记录一次写入的结果：失败时计数，连续失败只在第一次给出提示，恢复后再次失败时重新提示
+        void writeResult(bool ok, const std::string &pathname)
+        {
+            if (ok)
+            {
+                if (_failing.load(std::memory_order_relaxed))
+                    _failing.store(false, std::memory_order_relaxed);
+                return;
+            }
+            int err = errno;
+            _write_errors.fetch_add(1, std::memory_order_relaxed);
+            if (!_failing.exchange(true))
+                std::cout << "日志写入失败: " << pathname << " " << strerror(err) << std::endl;
+        }
+
+    private:
+        std::atomic<LogLevel::value> _level;
+        Filter _filter;
+        Formatter::ptr _formatter;
+        std::mutex _mutex;
+        std::atomic<size_t> _write_errors;
+        std::atomic<bool> _failing;
     };
 
     // 落地方向：标准输出
@@ -25,6 +141,15 @@ namespace mylog
         {
             std::cout.write(data, len);
         }
+        void log(const struct iovec *iov, int iovcnt)
+        {
+            for (int i = 0; i < iovcnt; ++i)
+                std::cout.write(static_cast<const char *>(iov[i].iov_base), iov[i].iov_len);
+        }
+        void flush()
+        {
+            std::cout.flush();
+        }
     };
 
     // 落地方向：指定文件
@@ -35,50 +160,203 @@ namespace mylog
         {
             // 创建文件所在目录
             util::File::createDirectory(util::File::path(pathname));
-            // 创建并打开文件
-            _ofs.open(pathname, std::ios::binary | std::ios::app);
-            assert(_ofs.is_open());
+            // 创建并打开文件，直接通过文件描述符写入，不再经过ofstream的内部缓冲区拷贝
+            _fd = util::File::openAppend(pathname);
+            if (_fd < 0)
+                std::cout << "日志文件打开失败: " << pathname << " " << strerror(errno) << std::endl;
+        }
+        ~FileSink()
+        {
+            if (_fd >= 0)
+                close(_fd);
         }
-
         void log(const char *data, const size_t &len)
         {
-            _ofs.write(data, len);
-            assert(_ofs.good());
+            writeResult(util::File::writeAll(_fd, data, len), _pathname);
+        }
+        void log(const struct iovec *iov, int iovcnt)
+        {
+            writeResult(util::File::writevAll(_fd, iov, iovcnt), _pathname);
+        }
+        // 以O_APPEND打开，一条日志一次writev，内核保证追加写入不交错
+        bool threadSafe() const
+        {
+            return true;
         }
 
     private:
-        std::ofstream _ofs;
+        int _fd;
         std::string _pathname;
     };
 
-    // 落地方向：滚动文件（以大小进行滚动）
+    /*
+        落地方向：滚动文件（以大小进行滚动）
+        下一个文件由辅助线程预先以临时文件名创建并打开，切换文件时写入线程只交换文件描述符；
+        旧文件的fsync和关闭、新文件改为正式文件名(按切换时间命名)都由辅助线程完成，写入线程不进行任何文件系统操作
+        辅助线程来不及准备时，写入线程直接以正式文件名打开新文件
+    */
     class RollBySizeSink : public LogSink
     {
     public:
-        RollBySizeSink(const std::string &basename, const size_t max_fsize)
-            : _basename(basename), _max_fsize(max_fsize), _cur_fsize(0), _name_count(0)
+        // build_index为true时，为每个文件生成稀疏索引(见index.hpp)
+        RollBySizeSink(const std::string &basename, const size_t max_fsize, bool build_index = false)
+            : _basename(basename), _max_fsize(max_fsize), _cur_fsize(0), _name_count(0), _build_index(build_index), _stop(false)
         {
-            std::string filename = createNewFile();
-            util::File::createDirectory(util::File::path(filename)); // 创建文件所在的文件夹
-            _ofs.open(filename, std::ios::binary | std::ios::app);   // 打开并创建文件
-            assert(_ofs.is_open());
+            util::File::createDirectory(util::File::path(basename)); // 创建文件所在的文件夹
+            _cur = openFile(createNewFile());                        // 打开并创建文件
+            _cur_fsize = _cur.size;
+            if (_build_index)
+                _index.attach(_cur.idx_fd, _cur.size);
+            _thread = std::thread(&RollBySizeSink::threadEntry, this);
         }
-        void log(const char *data, const size_t &len)
+        ~RollBySizeSink()
         {
-            if (_cur_fsize >= _max_fsize)
             {
-                _cur_fsize = 0;
-                _ofs.close();
-                std::string pathname = createNewFile();
-                _ofs.open(pathname, std::ios::binary | std::ios::app);
-                assert(_ofs.is_open());
+                std::unique_lock<std::mutex> lock(_roll_mutex);
+                _stop = true;
+            }
+            _cond.notify_all();
+            _thread.join();
+            _index.close();
+            close(_cur.fd);
+            // 没有用到的预备文件
+            if (_spare.fd >= 0)
+            {
+                close(_spare.fd);
+                unlink(_spare.pathname.c_str());
+                if (_spare.idx_fd >= 0)
+                {
+                    close(_spare.idx_fd);
+                    unlink((_spare.pathname + INDEX_SUFFIX).c_str());
+                }
             }
-            _cur_fsize += len;
-            _ofs.write(data, len);
-            assert(_ofs.good());
+        }
+        void log(const char *data, const size_t &len)
+        {
+            struct iovec iov = {const_cast<char *>(data), len};
+            log(&iov, 1);
+        }
+        void log(const struct iovec *iov, int iovcnt)
+        {
+            LogBatch batch = {iov, iovcnt, nullptr, 0};
+            log(batch);
+        }
+        void log(const LogBatch &batch)
+        {
+            rollOver();
+            // 按实际写入的字节数计算文件大小
+            size_t written = 0;
+            bool ret = util::File::writevAll(_cur.fd, batch.iov, batch.iovcnt, &written);
+            _cur_fsize += written;
+            writeResult(ret, _cur.pathname);
+            if (!_build_index)
+                return;
+            if (batch.count)
+                _index.append(batch.records, batch.count, written);
+            else
+                _index.skip(written);
         }
 
     private:
+        struct RollFile
+        {
+            int fd = -1;
+            int idx_fd = -1;
+            size_t size = 0;
+            std::string pathname; // 打开时的文件名
+            bool temp = false;    // 是否为临时文件名，启用后需要改为正式文件名
+        };
+        void rollOver() // 超过指定大小就切换到新文件
+        {
+            if (_cur_fsize < _max_fsize)
+                return;
+            RollFile next;
+            {
+                std::unique_lock<std::mutex> lock(_roll_mutex);
+                std::swap(next, _spare);
+            }
+            if (next.fd < 0)
+            {
+                std::string pathname;
+                {
+                    std::unique_lock<std::mutex> lock(_roll_mutex);
+                    pathname = createNewFile();
+                }
+                next = openFile(pathname);
+            }
+            RollFile old = _cur;
+            if (_build_index)
+            {
+                old.idx_fd = _index.release();
+                _index.attach(next.idx_fd, next.size);
+            }
+            _cur = next;
+            _cur_fsize = next.size;
+            {
+                std::unique_lock<std::mutex> lock(_roll_mutex);
+                _retired.push_back(old);
+                if (next.temp)
+                    _renames.push_back(next);
+            }
+            _cond.notify_all();
+        }
+        RollFile openFile(const std::string &pathname, bool temp = false)
+        {
+            RollFile file;
+            file.pathname = pathname;
+            file.temp = temp;
+            file.fd = util::File::openAppend(pathname);
+            assert(file.fd >= 0);
+            struct stat st;
+            file.size = fstat(file.fd, &st) == 0 ? st.st_size : 0;
+            if (_build_index)
+                file.idx_fd = util::File::openAppend(pathname + INDEX_SUFFIX);
+            return file;
+        }
+        // 辅助线程：准备下一个文件，处理切换下来的旧文件
+        void threadEntry()
+        {
+            std::unique_lock<std::mutex> lock(_roll_mutex);
+            while (true)
+            {
+                _cond.wait(lock, [&]()
+                           { return _stop || _spare.fd < 0 || !_retired.empty() || !_renames.empty(); });
+                std::deque<RollFile> retired, renames;
+                retired.swap(_retired);
+                renames.swap(_renames);
+                bool need_spare = !_stop && _spare.fd < 0;
+                // 在锁内分配正式文件名(与写入线程共用序号)，在锁外改名
+                std::vector<std::string> names;
+                for (size_t i = 0; i < renames.size(); ++i)
+                    names.push_back(createNewFile());
+                if (retired.empty() && renames.empty() && !need_spare)
+                {
+                    if (_stop)
+                        break;
+                    continue;
+                }
+                lock.unlock();
+                for (auto &file : retired)
+                {
+                    fsync(file.fd);
+                    close(file.fd);
+                    if (file.idx_fd >= 0)
+                        close(file.idx_fd);
+                }
+                for (size_t i = 0; i < renames.size(); ++i)
+                {
+                    ::rename(renames[i].pathname.c_str(), names[i].c_str());
+                    if (_build_index)
+                        ::rename((renames[i].pathname + INDEX_SUFFIX).c_str(), (names[i] + INDEX_SUFFIX).c_str());
+                }
+                RollFile spare;
+                if (need_spare)
+                    spare = openFile(tempName(), true);
+                lock.lock();
+                if (spare.fd >= 0)
+                    _spare = spare;
+            }
+        }
         std::string createNewFile() // 进行大小判读，超过指定大小就创建新文件
         {
             time_t t = util::Date::getTime();
@@ -97,14 +375,31 @@ namespace mylog
             ss << ".log";
             return ss.str();
         }
+        // 预备文件的临时文件名，包含进程号，多个进程使用相同的基础文件名时也不会冲突
+        std::string tempName()
+        {
+            std::stringstream ss;
+            ss << _basename << "next-" << getpid() << "-" << this << ".tmp";
+            return ss.str();
+        }
 
     private:
         // 通过基础文件名 + 拓展文件名（以生成时间）组成当前输出文件名
         size_t _name_count;
         std::string _basename; // 例如   ./logs/base-20240330201530.log
-        std::ofstream _ofs;
-        size_t _max_fsize; // 记录最大大小，超过大小就切换文件
-        size_t _cur_fsize; // 当前已经写入的文件的大小
+        RollFile _cur;         // 正在写入的文件，只由写入线程访问
+        size_t _max_fsize;     // 记录最大大小，超过大小就切换文件
+        size_t _cur_fsize;     // 当前文件已经写入的字节数
+        bool _build_index;
+        IndexWriter _index;
+        // 以下由_roll_mutex保护
+        std::mutex _roll_mutex;
+        std::condition_variable _cond;
+        bool _stop;
+        RollFile _spare;                // 预先打开的下一个文件
+        std::deque<RollFile> _retired;  // 等待fsync和关闭的旧文件
+        std::deque<RollFile> _renames;  // 等待改为正式文件名的文件
+        std::thread _thread;
     };
 
     class SinkFactory
@@ -0,0 +1,68 @@
+#ifndef __MY_SPILL__
+#define __MY_SPILL__
+#include "util.hpp"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <cstdio>
+
+namespace mylog
+{
+    /*
+        超长消息的溢出文件：消息主体超过日志器的最大长度时，完整内容追加到溢出文件中，
+        主日志中只保留开头部分和编号，异步缓冲区不会因为个别超长消息而扩容
+        每条内容的格式为：
+            ==== 编号 日志器名称 字节数
+            完整的消息主体
+        编号为"进程号.序号"，多个进程共用同一个溢出文件时也不会重复，可以直接在文件中搜索
+        写入在调用写日志的线程中进行(只在出现超长消息时发生)
+    */
+    class SpillFile
+    {
+    public:
+        using ptr = std::shared_ptr<SpillFile>;
+        SpillFile(const std::string &pathname) : _pathname(pathname), _seq(0)
+        {
+            util::File::createDirectory(util::File::path(pathname));
+            _fd = util::File::openAppend(pathname);
+            if (_fd < 0)
+                std::cout << "溢出文件打开失败: " << pathname << "，超长消息只截断" << std::endl;
+        }
+        ~SpillFile()
+        {
+            if (_fd >= 0)
+                close(_fd);
+        }
+        SpillFile(const SpillFile &) = delete;
+        SpillFile &operator=(const SpillFile &) = delete;
+        // 写入一条完整的消息主体，返回其编号，写入失败时返回空串
+        std::string write(const std::string &logger, const char *data, size_t len)
+        {
+            if (_fd < 0)
+                return "";
+            char id[48], head[64];
+            snprintf(id, sizeof(id), "%d.%llu", (int)getpid(), (unsigned long long)++_seq);
+            int head_len = snprintf(head, sizeof(head), " %zu\n", len);
+            std::string prefix = std::string("==== ") + id + " " + logger;
+            struct iovec iov[4] = {{&prefix[0], prefix.size()}, {head, (size_t)head_len}, {const_cast<char *>(data), len}, {const_cast<char *>("\n"), 1}};
+            // 一条内容一次writev写入；writevAll在部分写入时会分多次写，用锁保证本进程内不交错
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (!util::File::writevAll(_fd, iov, 4))
+                return "";
+            return id;
+        }
+        const std::string &pathname()
+        {
+            return _pathname;
+        }
+
+    private:
+        std::string _pathname;
+        int _fd;
+        std::atomic<uint64_t> _seq;
+        std::mutex _mutex;
+    };
+}
+
+#endif
@@ -3,8 +3,20 @@
 #include <iostream>
 #include <string>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <unistd.h>
+#include <cstring>
+#include <fcntl.h>
+#include <cerrno>
+#include <sys/uio.h>
+#include <climits>
 #include <ctime>
+#include <cstdint>
+#include <atomic>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define UTIL_HAS_TSC 1
+#endif
 
 namespace mylog
 {
@@ -18,6 +30,166 @@ namespace mylog
                 return (size_t)time(nullptr);
             }
         };
+        /*
+            基于TSC的时钟：首次使用时与系统时钟校准一次(约10毫秒)，之后读取时间只需一条rdtsc指令，没有系统调用
+            要求CPU支持恒定频率的TSC(现代x86处理器均支持)，长时间运行会与系统时钟产生少量偏差；非x86平台使用clock_gettime
+            可以只在写日志的线程中读取ticks()，由后台线程用toNs()换算为时间
+        */
+        class TscClock
+        {
+        public:
+            // 自1970年以来的纳秒数
+            static int64_t nowNs()
+            {
+                return toNs(ticks());
+            }
+            // 原始计数，非x86平台直接为纳秒数
+            static uint64_t ticks()
+            {
+#ifdef UTIL_HAS_TSC
+                return __rdtsc();
+#else
+                return (uint64_t)systemNs();
+#endif
+            }
+            static int64_t toNs(uint64_t ticks)
+            {
+#ifdef UTIL_HAS_TSC
+                const Calibration &c = calibration();
+                return c.base_ns + (int64_t)((double)(int64_t)(ticks - c.base_tsc) * c.ns_per_tick);
+#else
+                return (int64_t)ticks;
+#endif
+            }
+            // 提前完成校准，避免第一次写日志时等待
+            static void calibrate()
+            {
+#ifdef UTIL_HAS_TSC
+                calibration();
+#endif
+            }
+            static int64_t systemNs(clockid_t id = CLOCK_REALTIME)
+            {
+                struct timespec ts;
+                clock_gettime(id, &ts);
+                return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+            }
+
+        private:
+#ifdef UTIL_HAS_TSC
+            struct Calibration
+            {
+                uint64_t base_tsc;
+                int64_t base_ns;
+                double ns_per_tick;
+            };
+            static const Calibration &calibration()
+            {
+                static const Calibration c = measure();
+                return c;
+            }
+            static Calibration measure()
+            {
+                Calibration c;
+                int64_t ns0 = systemNs();
+                uint64_t tsc0 = __rdtsc();
+                struct timespec gap = {0, 10 * 1000 * 1000};
+                nanosleep(&gap, nullptr);
+                int64_t ns1 = systemNs();
+                uint64_t tsc1 = __rdtsc();
+                c.ns_per_tick = tsc1 > tsc0 ? (double)(ns1 - ns0) / (double)(tsc1 - tsc0) : 1.0;
+                c.base_tsc = tsc1;
+                c.base_ns = ns1;
+                return c;
+            }
+#endif
+        };
+        /*
+            日志时间戳的时钟来源，进程内全局设置：
+            COARSE 内核节拍更新的时间(CLOCK_REALTIME_COARSE)，最快，精度为毫秒级
+            FINE   CLOCK_REALTIME(经vDSO读取，不陷入内核)，纳秒精度，默认
+            TSC    校准后的TSC，见TscClock
+                   只有实时日志器在调用线程中保存原始计数、由后台线程换算；同步和异步日志器在调用线程中格式化，
+                   时间戳也在调用线程中换算为纳秒(一次乘加)，省去的只是clock_gettime本身
+        */
+        enum class ClockSource
+        {
+            COARSE,
+            FINE,
+            TSC
+        };
+        class Clock
+        {
+        public:
+            // 自1970年以来的纳秒数
+            static int64_t nowNs()
+            {
+                switch (source().load(std::memory_order_relaxed))
+                {
+                case ClockSource::COARSE:
+                    return TscClock::systemNs(CLOCK_REALTIME_COARSE);
+                case ClockSource::TSC:
+                    return TscClock::nowNs();
+                default:
+                    return TscClock::systemNs(CLOCK_REALTIME);
+                }
+            }
+            static void setSource(ClockSource src)
+            {
+                if (src == ClockSource::TSC)
+                    TscClock::calibrate();
+                source().store(src, std::memory_order_relaxed);
+            }
+            static ClockSource getSource()
+            {
+                return source().load(std::memory_order_relaxed);
+            }
+
+        private:
+            static std::atomic<ClockSource> &source()
+            {
+                static std::atomic<ClockSource> src(ClockSource::FINE);
+                return src;
+            }
+        };
+        // 线程标识：内核线程号或用户设置的线程名，预先渲染好，格式化时直接拷贝
+        struct ThreadInfo
+        {
+            pid_t tid;
+            size_t len;
+            char str[32];
+        };
+        class Thread
+        {
+        public:
+            // 当前线程的缓存标识，首次使用时通过gettid获取并渲染
+            static const ThreadInfo &current()
+            {
+                return info();
+            }
+            // 设置当前线程在日志中显示的名称(%t)，超出部分截断
+            static void setName(const std::string &name)
+            {
+                ThreadInfo &cur = info();
+                cur.len = std::min(name.size(), sizeof(cur.str) - 1);
+                memcpy(cur.str, name.data(), cur.len);
+                cur.str[cur.len] = '\0';
+            }
+
+        private:
+            static ThreadInfo &info()
+            {
+                static thread_local ThreadInfo cur = create();
+                return cur;
+            }
+            static ThreadInfo create()
+            {
+                ThreadInfo cur;
+                cur.tid = (pid_t)syscall(SYS_gettid);
+                cur.len = snprintf(cur.str, sizeof(cur.str), "%d", (int)cur.tid);
+                return cur;
+            }
+        };
         class File
         {
         public:
@@ -37,6 +209,67 @@ namespace mylog
                     return pathname;
                 return pathname.substr(0, pos + 1);
             }
+            // 以追加方式打开文件，一次write写入的完整日志不会和其他写入者交错
+            static int openAppend(const std::string &pathname)
+            {
+                return open(pathname.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+            }
+            // 写入全部数据，处理被信号打断和部分写入的情况
+            static bool writeAll(int fd, const char *data, size_t len)
+            {
+                while (len > 0)
+                {
+                    ssize_t ret = write(fd, data, len);
+                    if (ret < 0)
+                    {
+                        if (errno == EINTR)
+                            continue;
+                        return false;
+                    }
+                    data += ret;
+                    len -= ret;
+                }
+                return true;
+            }
+            // written不为空时累加实际写入的字节数(出错时为出错前已写入的部分)
+            static bool writevAll(int fd, const struct iovec *iov, int iovcnt, size_t *written = nullptr)
+            {
+                struct iovec tmp[IOV_MAX];
+                while (iovcnt > IOV_MAX)
+                {
+                    if (!writevAll(fd, iov, IOV_MAX, written))
+                        return false;
+                    iov += IOV_MAX;
+                    iovcnt -= IOV_MAX;
+                }
+                std::copy(iov, iov + iovcnt, tmp);
+                struct iovec *cur = tmp;
+                while (iovcnt > 0)
+                {
+                    ssize_t ret = writev(fd, cur, iovcnt);
+                    if (ret < 0)
+                    {
+                        if (errno == EINTR)
+                            continue;
+                        return false;
+                    }
+                    if (written)
+                        *written += ret;
+                    // 跳过已经写完的段，部分写入的段调整起始位置
+                    while (iovcnt > 0 && (size_t)ret >= cur->iov_len)
+                    {
+                        ret -= cur->iov_len;
+                        ++cur;
+                        --iovcnt;
+                    }
+                    if (iovcnt > 0)
+                    {
+                        cur->iov_base = static_cast<char *>(cur->iov_base) + ret;
+                        cur->iov_len -= ret;
+                    }
+                }
+                return true;
+            }
             static void createDirectory(const std::string &pathname)
             {
                 //   ./abc/ef/q